@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include "arena.h"
+
+//room for the per-frame scratch, the peak is reported by -checkalloc
+#define FRAMEARENASIZE (4 << 20)
+
+alignas(64) static char frameMemory[FRAMEARENASIZE];
+Arena frameArena = { frameMemory, FRAMEARENASIZE, 0, 0 };
+
+//replaces frameMemory once scratch that scales with the scene outgrows it
+static char* grownMemory = NULL;
+
+void initArena(Arena& arena, void* memory, size_t capacity)
+{
+	arena.base = (char*)memory;
+	arena.capacity = capacity;
+	arena.used = 0;
+	arena.peak = 0;
+}
+
+void* arenaAlloc(Arena& arena, size_t size, size_t align)
+{
+	//align the address, the memory itself may be less aligned than asked for
+	uintptr_t base = (uintptr_t)arena.base;
+	size_t start = ((base + arena.used + align - 1) & ~uintptr_t(align - 1)) - base;
+	if (start + size > arena.capacity){
+		printf("Arena of %zu bytes is out of memory, %zu more requested\n", arena.capacity, size);
+		exit(EXIT_FAILURE);
+	}
+
+	arena.used = start + size;
+	if (arena.used > arena.peak)
+		arena.peak = arena.used;
+	return arena.base + start;
+}
+
+void reserveFrameArena(size_t scratch)
+{
+	size_t capacity = FRAMEARENASIZE + scratch;
+	if (capacity <= frameArena.capacity)
+		return;
+
+	//only between frames, nothing handed out this frame may still be in use
+	delete[] grownMemory;
+	grownMemory = new char[capacity];
+	size_t peak = frameArena.peak;
+	initArena(frameArena, grownMemory, capacity);
+	frameArena.peak = peak;
+}
+
+#pragma region allocation counter
+
+//per thread, so other threads allocating on their own schedule never fail a frame
+static thread_local long long allocations = 0;
+static thread_local int exemptDepth = 0;
+
+long long heapAllocations()
+{
+	return allocations;
+}
+
+AllocExempt::AllocExempt()
+{
+	++exemptDepth;
+}
+
+AllocExempt::~AllocExempt()
+{
+	--exemptDepth;
+}
+
+static void* countedAlloc(size_t size)
+{
+	if (!exemptDepth)
+		++allocations;
+	return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+	void* p = countedAlloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = countedAlloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+//allocation counter
+#pragma endregion
+
+static bool checking = false;
+static std::atomic<bool> failed(false);
+static int warmupFrames = 0;
+static int checkedFrames = 0;
+static long long frameStart = 0;
+
+static void reportAllocCheck()
+{
+	if (checking)
+		printf("-checkalloc: %d frames after warm up without heap allocations, frame arena peak %zu KB\n",
+			   checkedFrames, frameArena.peak / 1024);
+}
+
+void initAllocCheck(int warmup)
+{
+	checking = true;
+	failed = false;
+	warmupFrames = warmup;
+	checkedFrames = 0;
+	atexit(reportAllocCheck);
+}
+
+void allocFrameBegin()
+{
+	arenaReset(frameArena);
+	frameStart = heapAllocations();
+}
+
+void allocFrameEnd()
+{
+	if (!checking)
+		return;
+
+	if (warmupFrames > 0){
+		--warmupFrames;
+		return;
+	}
+
+	long long count = heapAllocations() - frameStart;
+	if (count){
+		printf("-checkalloc: frame %d after warm up allocated %lld times\n", checkedFrames, count);
+		checking = false;
+		failed = true;
+		return;
+	}
+	++checkedFrames;
+}
+
+bool allocCheckFailed()
+{
+	return failed.load();
+}
@@ -0,0 +1,107 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <cstddef>
+#include <new>
+
+//memory that does not go through the heap while frames are drawn
+//an arena hands out memory by bumping an offset and frees everything at once,
+//a pool keeps a fixed number of objects of one type on a free list,
+//and a counter of every operator new checks that frames really stay off the heap (-checkalloc)
+
+struct Arena{
+	char*	base;
+	size_t	capacity;
+	size_t	used;
+	size_t	peak;		//most ever used, for sizing the arena
+};
+
+//the arena works inside memory, which it does not own
+void initArena(Arena& arena, void* memory, size_t capacity);
+
+//size bytes aligned to align (a power of two), exits when the arena is full
+void* arenaAlloc(Arena& arena, size_t size, size_t align = 16);
+
+//count uninitialized elements, only for types without a constructor that matters
+template <class T>
+inline T* arenaArray(Arena& arena, size_t count)
+{ return (T*)arenaAlloc(arena, count * sizeof(T), alignof(T)); }
+
+//scratch use: take a mark, allocate, release back to the mark
+inline size_t arenaMark(const Arena& arena) { return arena.used; }
+inline void arenaRelease(Arena& arena, size_t mark) { arena.used = mark; }
+inline void arenaReset(Arena& arena) { arena.used = 0; }
+
+//scratch memory of the thread that draws, emptied at the start of every frame
+extern Arena frameArena;
+
+//make room for scratch bytes that scale with the scene on top of the usual frame scratch,
+//the arena moves to the heap when it has to grow, so call it between frames only
+void reserveFrameArena(size_t scratch);
+
+//fixed capacity pool, create and destroy never touch the heap
+template <class T, int N>
+struct Pool{
+	union Slot{
+		Slot*	next;
+		alignas(T) unsigned char	storage[sizeof(T)];
+	};
+
+	Slot	slots[N];
+	Slot*	freeList;
+	int		live;
+
+	Pool() : live(0)
+	{
+		for (int i = 0; i < N - 1; ++i)
+			slots[i].next = &slots[i + 1];
+		slots[N - 1].next = NULL;
+		freeList = &slots[0];
+	}
+
+	//NULL when all N are in use
+	T* create()
+	{
+		if (!freeList)
+			return NULL;
+		Slot* slot = freeList;
+		freeList = slot->next;
+		++live;
+		return new (slot->storage) T();
+	}
+
+	void destroy(T* object)
+	{
+		object->~T();
+		Slot* slot = (Slot*)object;
+		slot->next = freeList;
+		freeList = slot;
+		--live;
+	}
+};
+
+//operator new calls so far on the calling thread, none while it is exempt
+//malloc calls, like the ones inside the GL driver and GLFW, are not seen
+long long heapAllocations();
+
+//the allocations of this thread are not counted while one of these lives, for threads
+//and bookkeeping that allocate on their own schedule (the capture writer, the profiler)
+struct AllocExempt{
+	AllocExempt();
+	~AllocExempt();
+};
+
+//-checkalloc: frames after warmup must not allocate, the first one that does fails the check
+//only the thread that draws the frame is checked, job workers, the -threaded main thread
+//and the capture writer may allocate without failing it
+void initAllocCheck(int warmup);
+
+//frame boundaries, also reset the frame arena
+void allocFrameBegin();
+void allocFrameEnd();
+
+//true once a checked frame allocated, from any thread, the frame loops stop on it
+//and the main thread exits with a failure once the renderer is done
+bool allocCheckFailed();
+
+#endif //__ARENA__
@@ -0,0 +1,509 @@
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include "openglutl.h"
+#include "trackball.h"
+#include "simdmath.h"
+#include "tvec.h"
+#include "jobs.h"
+#include "arena.h"
+#include "microbench.h"
+
+//microbenchmarks for vec.h, mat.h and the trackball math, built with MATH_ONLY
+//every benchmark cycles through a small table of inputs so nothing folds into a constant
+//arithmetic results are converted to their vec or mat type before doNotOptimize, with
+//CS419_VEC_EXPR (cs419_microbench_expr) they are otherwise unevaluated expressions
+
+#define INPUTS 64
+
+static float	scalars[INPUTS];
+static vec3		vec3s[INPUTS];
+static vec4		vec4s[INPUTS];
+static vec4		quats[INPUTS];
+static mat4		mat4s[INPUTS];
+static mat3x4	affines[INPUTS];
+static double	cursor[INPUTS][2];
+
+//the transcendental benchmarks work on a batch of BATCH values per iteration
+#define BATCH 256
+
+static float	angles[BATCH];
+static float	ratios[BATCH];
+static float	batchOut[BATCH];
+static float	batchOut2[BATCH];
+static unsigned short	halves[BATCH];
+
+static float randomFloat(float lo, float hi)
+{
+	return lo + (hi - lo) * (rand() / float(RAND_MAX));
+}
+
+static void initInputs()
+{
+	srand(419);
+	for (int i = 0; i < INPUTS; ++i){
+		scalars[i] = randomFloat(0.5f, 2.0f);
+		vec3s[i] = vec3(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(0.1f, 1));
+		vec4s[i] = vec4(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), 1.0f);
+		quats[i] = normalize(vec4(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1)));
+		mat4s[i] = Translate(vec4s[i]) * RotateX(randomFloat(0, 360)) * RotateY(randomFloat(0, 360)) * Scale(vec3s[i] + vec3(1, 1, 1));
+		affines[i] = mat3x4(mat4s[i]);
+		cursor[i][0] = randomFloat(0, 512);
+		cursor[i][1] = randomFloat(0, 512);
+	}
+	for (int i = 0; i < BATCH; ++i){
+		angles[i] = randomFloat(-8, 8);
+		ratios[i] = randomFloat(-1, 1);
+	}
+}
+
+#define A(arr) arr[i & (INPUTS - 1)]
+#define B(arr) arr[(i + 1) & (INPUTS - 1)]
+
+#pragma region vec.h
+
+MICROBENCH(vec3_add){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec3(A(vec3s) + B(vec3s)));
+}
+
+MICROBENCH(vec3_scale){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec3(A(scalars) * A(vec3s)));
+}
+
+MICROBENCH(vec3_dot){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(dot(A(vec3s), B(vec3s)));
+}
+
+MICROBENCH(vec3_cross){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(cross(A(vec3s), B(vec3s)));
+}
+
+MICROBENCH(vec3_length){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(length(A(vec3s)));
+}
+
+MICROBENCH(vec3_normalize){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(normalize(A(vec3s)));
+}
+
+MICROBENCH(vec4_add){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(vec4s) + B(vec4s)));
+}
+
+MICROBENCH(vec4_sub){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(vec4s) - B(vec4s)));
+}
+
+MICROBENCH(vec4_mul){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(vec4s) * B(vec4s)));
+}
+
+MICROBENCH(vec4_scale){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(scalars) * A(vec4s)));
+}
+
+MICROBENCH(vec4_div){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(vec4s) / A(scalars)));
+}
+
+MICROBENCH(vec4_add_assign){
+	vec4 sum;
+	for (long long i = 0; i < iterations; ++i){
+		sum += A(vec4s);
+		doNotOptimize(sum);
+	}
+}
+
+MICROBENCH(vec4_dot){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(dot(A(vec4s), B(vec4s)));
+}
+
+MICROBENCH(vec4_normalize){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(normalize(A(vec4s)));
+}
+
+MICROBENCH(vec4_cross){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(cross(A(vec4s), B(vec4s)));
+}
+
+#pragma endregion
+
+#pragma region mat.h
+
+MICROBENCH(mat4_add){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(mat4(A(mat4s) + B(mat4s)));
+}
+
+MICROBENCH(mat4_scale){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(mat4(A(scalars) * A(mat4s)));
+}
+
+MICROBENCH(mat4_mul_mat4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(A(mat4s) * B(mat4s));
+}
+
+MICROBENCH(mat4_mul_vec4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(A(mat4s) * B(vec4s));
+}
+
+MICROBENCH(mat4_transpose){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(transpose(A(mat4s)));
+}
+
+MICROBENCH(mat4_matrixCompMult){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(matrixCompMult(A(mat4s), B(mat4s)));
+}
+
+MICROBENCH(RotateX){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(RotateX(A(scalars) * 90));
+}
+
+MICROBENCH(Translate){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(Translate(A(vec4s)));
+}
+
+MICROBENCH(Scale){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(Scale(A(vec3s)));
+}
+
+MICROBENCH(LookAt){
+	vec4 at(0, 0, 0, 1);
+	vec4 up(0, 1, 0, 0);
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(LookAt(A(vec4s) + vec4(0, 0, 2, 0), at, up));
+}
+
+MICROBENCH(Perspective){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(Perspective(45 * A(scalars), 1.3f, 0.1f, 15.0f));
+}
+
+MICROBENCH(Ortho){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(Ortho(-A(scalars), A(scalars), -1, 1, 0.1f, 15.0f));
+}
+
+MICROBENCH(Normal){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(Normal(A(mat4s)));
+}
+
+MICROBENCH(mat4_inverse){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(inverse(A(mat4s)));
+}
+
+MICROBENCH(mat3x4_mul_mat3x4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(A(affines) * B(affines));
+}
+
+//walking down a scene graph, each transform composed onto its parent's
+MICROBENCH(mat4_compose_chain){
+	mat4 world;
+	for (long long i = 0; i < iterations; ++i){
+		world = world * A(mat4s);
+		doNotOptimize(world[0][0]);
+	}
+	doNotOptimize(world);
+}
+
+MICROBENCH(mat3x4_compose_chain){
+	mat3x4 world;
+	for (long long i = 0; i < iterations; ++i){
+		world = world * A(affines);
+		doNotOptimize(world[0][0]);
+	}
+	doNotOptimize(world);
+}
+
+MICROBENCH(mat3x4_mul_vec4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(A(affines) * A(vec4s));
+}
+
+MICROBENCH(mat3x4_inverse){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(inverse(A(affines)));
+}
+
+MICROBENCH(mat3x4_rigidInverse){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(rigidInverse(A(affines)));
+}
+
+#pragma endregion
+
+#pragma region expressions
+
+//chains that make a temporary per operator without the expression templates
+
+MICROBENCH(expr_vec4_mad){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec4(A(vec4s) * B(vec4s) + A(scalars) * B(vec4s) - A(vec4s)));
+}
+
+MICROBENCH(expr_vec3_lerp){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec3(A(vec3s) + (B(vec3s) - A(vec3s)) * A(scalars)));
+}
+
+MICROBENCH(expr_vec3_quat_vector){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(vec3(cross(A(vec3s), B(vec3s)) + A(scalars) * B(vec3s) + B(scalars) * A(vec3s)));
+}
+
+MICROBENCH(expr_mat4_blend){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(mat4(A(mat4s) * (1 - A(scalars)) + B(mat4s) * A(scalars)));
+}
+
+#pragma endregion
+
+#pragma region trackball
+
+MICROBENCH(q_multiply){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(q_multiply(A(quats), B(quats)));
+}
+
+MICROBENCH(hemisphereMap){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(hemisphereMap(A(cursor)[0], A(cursor)[1], 512, 512));
+}
+
+MICROBENCH(trackballRotation){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(trackballRotation(A(cursor)[0], A(cursor)[1], B(cursor)[0], B(cursor)[1], 1.0, 512, 512));
+}
+
+#pragma endregion
+
+#pragma region tvec.h
+
+MICROBENCH(dvec3_add){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(dvec3(A(vec3s)) + dvec3(B(vec3s)));
+}
+
+MICROBENCH(dvec3_cross){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(cross(dvec3(A(vec3s)), dvec3(B(vec3s))));
+}
+
+MICROBENCH(dmat4_mul_dmat4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(dmat4(A(mat4s)) * dmat4(B(mat4s)));
+}
+
+MICROBENCH(hvec4_from_vec4){
+	for (long long i = 0; i < iterations; ++i)
+		doNotOptimize(hvec4(A(vec4s)));
+}
+
+MICROBENCH(half_scalar){
+	for (long long i = 0; i < iterations; ++i){
+		for (int k = 0; k < BATCH; ++k)
+			halves[k] = floatToHalf(angles[k]);
+		doNotOptimize(halves);
+	}
+}
+
+MICROBENCH(half_batch){
+	for (long long i = 0; i < iterations; ++i){
+		floatsToHalves(angles, halves, BATCH);
+		doNotOptimize(halves);
+	}
+}
+
+#pragma endregion
+
+#pragma region simdmath.h
+
+MICROBENCH(sin_libm){
+	for (long long i = 0; i < iterations; ++i){
+		for (int k = 0; k < BATCH; ++k)
+			batchOut[k] = std::sin(angles[k]);
+		doNotOptimize(batchOut);
+	}
+}
+
+MICROBENCH(sin_batch){
+	for (long long i = 0; i < iterations; ++i){
+		sinBatch(angles, batchOut, BATCH);
+		doNotOptimize(batchOut);
+	}
+}
+
+MICROBENCH(sincos_libm){
+	for (long long i = 0; i < iterations; ++i){
+		for (int k = 0; k < BATCH; ++k){
+			batchOut[k] = std::sin(angles[k]);
+			batchOut2[k] = std::cos(angles[k]);
+		}
+		doNotOptimize(batchOut);
+		doNotOptimize(batchOut2);
+	}
+}
+
+MICROBENCH(sincos_batch){
+	for (long long i = 0; i < iterations; ++i){
+		sincosBatch(angles, batchOut, batchOut2, BATCH);
+		doNotOptimize(batchOut);
+		doNotOptimize(batchOut2);
+	}
+}
+
+MICROBENCH(sincos_steps){
+	for (long long i = 0; i < iterations; ++i){
+		sincosSteps(A(scalars), 0.01, BATCH, batchOut, batchOut2);
+		doNotOptimize(batchOut);
+		doNotOptimize(batchOut2);
+	}
+}
+
+MICROBENCH(atan2_libm){
+	for (long long i = 0; i < iterations; ++i){
+		for (int k = 0; k < BATCH; ++k)
+			batchOut[k] = std::atan2(ratios[k], angles[k]);
+		doNotOptimize(batchOut);
+	}
+}
+
+MICROBENCH(atan2_batch){
+	for (long long i = 0; i < iterations; ++i){
+		atan2Batch(ratios, angles, batchOut, BATCH);
+		doNotOptimize(batchOut);
+	}
+}
+
+MICROBENCH(asin_libm){
+	for (long long i = 0; i < iterations; ++i){
+		for (int k = 0; k < BATCH; ++k)
+			batchOut[k] = std::asin(ratios[k]);
+		doNotOptimize(batchOut);
+	}
+}
+
+MICROBENCH(asin_batch){
+	for (long long i = 0; i < iterations; ++i){
+		asinBatch(ratios, batchOut, BATCH);
+		doNotOptimize(batchOut);
+	}
+}
+
+#pragma endregion
+
+#pragma region jobs.h
+
+//scaling of the job system, the same transform with 1, 2, 4 and 8 threads
+//a thread count above the core count only shows the cost of oversubscription
+#define JOBVERTS 16384
+
+static vec4 jobIn[JOBVERTS];
+static vec4 jobOut[JOBVERTS];
+
+static void useJobThreads(int threads)
+{
+	if (jobThreads() != threads){
+		shutdownJobs();
+		initJobs(threads);
+	}
+}
+
+static void transformRange(int begin, int end, void* data)
+{
+	const mat4& m = *(const mat4*)data;
+	for (int k = begin; k < end; ++k)
+		jobOut[k] = m * jobIn[k];
+}
+
+static void transformJobs(long long iterations, int threads)
+{
+	useJobThreads(threads);
+	for (int k = 0; k < JOBVERTS; ++k)
+		jobIn[k] = vec4s[k & (INPUTS - 1)];
+
+	for (long long i = 0; i < iterations; ++i){
+		parallelFor(0, JOBVERTS, 1024, transformRange, &A(mat4s));
+		doNotOptimize(jobOut);
+	}
+}
+
+MICROBENCH(jobs_transform16k_t1){ transformJobs(iterations, 1); }
+MICROBENCH(jobs_transform16k_t2){ transformJobs(iterations, 2); }
+MICROBENCH(jobs_transform16k_t4){ transformJobs(iterations, 4); }
+MICROBENCH(jobs_transform16k_t8){ transformJobs(iterations, 8); }
+
+static void emptyJob(void*)
+{
+}
+
+//submit, run and wait for one job, the overhead every job pays
+static void emptyJobs(long long iterations, int threads)
+{
+	useJobThreads(threads);
+	for (long long i = 0; i < iterations; ++i){
+		JobCounter done;
+		runJob(emptyJob, NULL, &done);
+		waitJobs(&done);
+	}
+}
+
+MICROBENCH(jobs_empty_t1){ emptyJobs(iterations, 1); }
+MICROBENCH(jobs_empty_t4){ emptyJobs(iterations, 4); }
+
+#pragma endregion
+
+#pragma region arena.h
+
+//per-frame scratch of 1024 sort keys, the size sortInstances takes for 1024 instances
+#define SCRATCH 1024
+
+MICROBENCH(scratch_vector){
+	for (long long i = 0; i < iterations; ++i){
+		std::vector<std::pair<float, int> > order(SCRATCH);
+		order[i & (SCRATCH - 1)].first = A(scalars);
+		doNotOptimize(order[0]);
+	}
+}
+
+MICROBENCH(scratch_arena){
+	for (long long i = 0; i < iterations; ++i){
+		arenaReset(frameArena);
+		std::pair<float, int>* order = arenaArray<std::pair<float, int> >(frameArena, SCRATCH);
+		order[i & (SCRATCH - 1)].first = A(scalars);
+		doNotOptimize(order[0]);
+	}
+}
+
+#pragma endregion
+
+int main(int argc, char** argv)
+{
+	initInputs();
+	return runMicrobenchmarks(argc, argv);
+}
@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include "benchmark.h"
+#include "profiler.h"
+
+void initBenchConfig(BenchConfig& config)
+{
+	config.meshM.clear();
+	config.meshN.clear();
+	config.instances.clear();
+	config.frames = 300;
+	config.warmup = 30;
+	config.outPath = NULL;
+	config.mode = "texture";
+}
+
+bool parseMeshList(const char* list, BenchConfig& config)
+{
+	config.meshM.clear();
+	config.meshN.clear();
+
+	while (*list){
+		int m, n, used = 0;
+		if (sscanf(list, "%dx%d%n", &m, &n, &used) != 2 || m < 1 || n < 3){
+			printf("Bad mesh size list '%s', expected e.g. 20x40,40x80\n", list);
+			return false;
+		}
+		config.meshM.push_back(m);
+		config.meshN.push_back(n);
+
+		list += used;
+		if (*list == ',')
+			++list;
+	}
+	return !config.meshM.empty();
+}
+
+bool parseIntList(const char* list, std::vector<int>& values)
+{
+	values.clear();
+
+	while (*list){
+		int v, used = 0;
+		if (sscanf(list, "%d%n", &v, &used) != 1 || v < 1){
+			printf("Bad list '%s', expected e.g. 1,8,64\n", list);
+			return false;
+		}
+		values.push_back(v);
+
+		list += used;
+		if (*list == ',')
+			++list;
+	}
+	return !values.empty();
+}
+
+void benchPath(int frame, vec4& rotation, vec4& eyePosition)
+{
+	double t = frame * BENCHDT;
+
+	//spin about a slowly wandering axis
+	vec3 axis = normalize(vec3(sin(0.3 * t), 1.0, 0.5 * cos(0.2 * t)));
+	double angle = 1.2 * t;
+	float s = sin(angle / 2);
+	rotation = vec4(cos(angle / 2), axis.x * s, axis.y * s, axis.z * s);
+
+	//sway the camera left and right and up and down at a fixed distance
+	double yaw = 0.25 * sin(0.5 * t);
+	double pitch = 0.15 * sin(0.37 * t);
+	eyePosition = vec4(2.0 * sin(yaw) * cos(pitch), 2.0 * sin(pitch), 2.0 * cos(yaw) * cos(pitch), 1.0);
+}
+
+bool runBenchmark(const BenchConfig& config, long long (*setup)(int, int, int), bool (*frame)(int))
+{
+	FILE* out = NULL;
+	if (config.outPath){
+		out = fopen(config.outPath, "w");
+		if (!out){
+			printf("Failed to open %s\n", config.outPath);
+			return false;
+		}
+		fprintf(out, "mode,m,n,instances,triangles,frames,seconds,fps,cpu_ms,cpu_p99_ms,gpu_ms,gpu_p99_ms\n");
+	}
+
+	//the mode column fits the label
+	int modeWidth = strlen(config.mode) > 8 ? int(strlen(config.mode)) : 8;
+	printf("%-*s %9s %9s %12s %9s %9s %9s %9s\n", modeWidth, "mode", "mesh", "instances", "triangles",
+		   "fps", "cpu ms", "gpu ms", "gpu p99");
+
+	for (size_t mesh = 0; mesh < config.meshM.size(); ++mesh){
+		for (size_t inst = 0; inst < config.instances.size(); ++inst){
+			int m = config.meshM[mesh];
+			int n = config.meshN[mesh];
+			int instances = config.instances[inst];
+
+			long long triangles = setup(m, n, instances);
+
+			//every run starts from the same point on the path
+			bool running = true;
+			for (int i = 0; i < config.warmup && running; ++i)
+				running = frame(i);
+
+			glFinish();
+			profileFlush();
+			profileReset();
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			for (int i = 0; i < config.frames && running; ++i)
+				running = frame(config.warmup + i);
+
+			//count the GPU work of the last frames too
+			glFinish();
+
+			if (!running){
+				if (out)
+					fclose(out);
+				return false;
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+			profileFlush();
+
+			ProfileStats cpu = { 0, 0.0, 0.0, 0.0 };
+			ProfileStats gpu = { 0, 0.0, 0.0, 0.0 };
+			profileStats("frame", false, cpu);
+			profileStats("display", true, gpu);
+
+			double fps = config.frames / seconds;
+
+			//an unknown triangle count is printed as - and left empty in the CSV
+			char meshName[32], triangleText[32];
+			sprintf(meshName, "%dx%d", m, n);
+			if (triangles >= 0)
+				sprintf(triangleText, "%lld", triangles);
+			else
+				triangleText[0] = 0;
+			printf("%-*s %9s %9d %12s %9.1f %9.3f %9.3f %9.3f\n", modeWidth, config.mode, meshName, instances,
+				   triangles >= 0 ? triangleText : "-", fps, cpu.avgMs, gpu.avgMs, gpu.p99Ms);
+
+			if (out){
+				fprintf(out, "%s,%d,%d,%d,%s,%d,%.6f,%.3f,%.4f,%.4f,%.4f,%.4f\n", config.mode, m, n, instances,
+						triangleText, config.frames, seconds, fps, cpu.avgMs, cpu.p99Ms, gpu.avgMs, gpu.p99Ms);
+				fflush(out);
+			}
+		}
+	}
+
+	if (out){
+		fclose(out);
+		printf("Wrote results to %s\n", config.outPath);
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef __BENCHMARK__
+#define __BENCHMARK__
+
+#include <vector>
+#include "openglutl.h"
+
+//reproducible renderer benchmark
+//every run replays the same scripted rotation and camera path at a fixed
+//timestep, so results only depend on the mesh, instance count and hardware
+
+//simulated seconds per benchmark frame
+#define BENCHDT (1.0 / 60.0)
+
+struct BenchConfig{
+	std::vector<int>	meshM;		//tessellation sweep, meshM[i] x meshN[i]
+	std::vector<int>	meshN;
+	std::vector<int>	instances;	//instance count sweep
+	int					frames;		//measured frames per run
+	int					warmup;		//frames thrown away before measuring
+	const char*			outPath;	//CSV results, NULL for stdout only
+	const char*			mode;		//free form label written with every row
+};
+
+//defaults: empty sweeps, 300 frames after 30 warm up frames, no CSV
+//the caller fills sweeps the command line left empty with its own scene
+void initBenchConfig(BenchConfig& config);
+
+//parse "20x40,40x80" and "1,8,64" style sweep lists
+bool parseMeshList(const char* list, BenchConfig& config);
+bool parseIntList(const char* list, std::vector<int>& values);
+
+//rotation quaternion and eye position of the scripted path at the given frame
+void benchPath(int frame, vec4& rotation, vec4& eyePosition);
+
+//run every combination of the sweeps
+//setup(m, n, instances) rebuilds the scene and returns the triangles a frame draws,
+//negative when the GPU decides, frame(index) renders one frame of the path
+//and returns false to stop the sweep, false when the sweep did not finish
+bool runBenchmark(const BenchConfig& config, long long (*setup)(int, int, int), bool (*frame)(int));
+
+#endif //__BENCHMARK__
@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include "bumpmap.h"
+#include "jobs.h"
+
+//integer hash for lattice values, wraps at period so the noise tiles
+static float latticeValue(int x, int y, int period)
+{
+	unsigned int h = unsigned((x % period + period) % period) * 73856093u
+				   ^ unsigned((y % period + period) % period) * 19349663u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	h ^= h >> 16;
+	return (h & 0xffff) / 65535.0f;
+}
+
+//smoothly interpolated value noise with the given lattice period
+static float valueNoise(float u, float v, int period)
+{
+	float x = u * period;
+	float y = v * period;
+	int x0 = int(std::floor(x));
+	int y0 = int(std::floor(y));
+	float fx = x - x0;
+	float fy = y - y0;
+
+	//smoothstep weights
+	fx = fx * fx * (3 - 2 * fx);
+	fy = fy * fy * (3 - 2 * fy);
+
+	float a = latticeValue(x0, y0, period);
+	float b = latticeValue(x0 + 1, y0, period);
+	float c = latticeValue(x0, y0 + 1, period);
+	float d = latticeValue(x0 + 1, y0 + 1, period);
+
+	return (a + (b - a) * fx) + ((c + (d - c) * fx) - (a + (b - a) * fx)) * fy;
+}
+
+void genHeightField(std::vector<float>& height, int size)
+{
+	height.resize(size * size);
+
+	for (int y = 0; y < size; ++y){
+		for (int x = 0; x < size; ++x){
+			float u = float(x) / size;
+			float v = float(y) / size;
+
+			//a few octaves of noise for a rubbery surface
+			float h = 0.0f;
+			float amp = 0.5f;
+			for (int period = 8; period <= 64; period *= 2){
+				h += amp * valueNoise(u, v, period);
+				amp *= 0.5f;
+			}
+
+			//raised seams between the six gores of the beach ball
+			float gore = u * 6 - std::floor(u * 6);
+			float seam = std::fabs(gore - 0.5f) * 2;
+			h += 0.5f * std::pow(seam, 16.0f);
+
+			height[y * size + x] = h / 1.5f;
+		}
+	}
+}
+
+//bake rows [y0, y1) of the normal map
+static void bakeRows(const float* height, int size, float strength,
+					 unsigned char* normalMap, int y0, int y1)
+{
+	for (int y = y0; y < y1; ++y){
+		//t does not wrap (poles), u does
+		int yUp = (y + 1 < size) ? y + 1 : y;
+		int yDown = (y > 0) ? y - 1 : y;
+
+		for (int x = 0; x < size; ++x){
+			int xRight = (x + 1) % size;
+			int xLeft = (x + size - 1) % size;
+
+			float du = height[y * size + xRight] - height[y * size + xLeft];
+			float dv = height[yUp * size + x] - height[yDown * size + x];
+
+			//the bitangent cross(N, T) points toward decreasing t on the sphere,
+			//so the t derivative keeps its sign
+			vec3 n = normalize(vec3(-strength * du * 0.5f, strength * dv * 0.5f, 1.0f));
+
+			unsigned char* texel = &normalMap[(y * size + x) * 3];
+			texel[0] = (unsigned char)((n.x * 0.5f + 0.5f) * 255.0f + 0.5f);
+			texel[1] = (unsigned char)((n.y * 0.5f + 0.5f) * 255.0f + 0.5f);
+			texel[2] = (unsigned char)((n.z * 0.5f + 0.5f) * 255.0f + 0.5f);
+		}
+	}
+}
+
+//rows per piece of the bake
+#define BAKEGRAIN 16
+
+struct BakeJob{
+	const float*	height;
+	int				size;
+	float			strength;
+	unsigned char*	normalMap;
+};
+
+static void bakeJob(int begin, int end, void* data)
+{
+	BakeJob& job = *(BakeJob*)data;
+	bakeRows(job.height, job.size, job.strength, job.normalMap, begin, end);
+}
+
+void bakeNormalMap(const std::vector<float>& height, int size, float strength,
+				   std::vector<unsigned char>& normalMap)
+{
+	normalMap.resize(size * size * 3);
+
+	BakeJob job = { &height[0], size, strength, &normalMap[0] };
+	parallelFor(0, size, BAKEGRAIN, bakeJob, &job, "bakeNormalMap");
+}
+
+GLuint genBumpTexture(GLenum unit, int size, float strength)
+{
+	std::vector<float> height;
+	std::vector<unsigned char> normalMap;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	genHeightField(height, size);
+	bakeNormalMap(height, size, strength, normalMap);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Baked %dx%d normal map in %.2f ms\n", size, size, ms);
+
+	glActiveTexture(unit);
+
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, &normalMap[0]);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glActiveTexture(GL_TEXTURE0);
+
+	return tex;
+}
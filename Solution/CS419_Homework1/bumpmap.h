@@ -0,0 +1,20 @@
+#ifndef __BUMP_MAP__
+#define __BUMP_MAP__
+
+#include <vector>
+#include "openglutl.h"
+
+//procedural bump map generation, baked on the CPU so no extra texture files are needed
+
+//fill height with a size x size tileable height field in [0, 1]
+void genHeightField(std::vector<float>& height, int size);
+
+//convert a height field into a tangent space normal map (RGB, 3 bytes per texel)
+//rows are split across the job system
+void bakeNormalMap(const std::vector<float>& height, int size, float strength,
+				   std::vector<unsigned char>& normalMap);
+
+//generate, bake and upload a normal map to the given texture unit, returns the texture id
+GLuint genBumpTexture(GLenum unit, int size, float strength);
+
+#endif //__BUMP_MAP__
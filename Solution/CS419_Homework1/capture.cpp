@@ -0,0 +1,365 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "capture.h"
+#include "arena.h"
+
+//frames waiting for the writer thread before captureFrame blocks
+#define MAXQUEUED 16
+
+//pixel buffers ever needed: the queued ones, one being written and one being filled
+#define MAXBUFFERS (MAXQUEUED + 2)
+
+struct CaptureSlot{
+	GLuint	pbo;
+	GLsync	fence;
+	int		frame;
+	int		width;
+	int		height;
+	int		size;
+};
+
+struct CaptureJob{
+	int		frame;
+	int		width;
+	int		height;
+	std::vector<unsigned char>* pixels;
+};
+
+static std::vector<CaptureSlot> slots;
+static int nextSlot = 0;
+static int frameCount = 0;
+
+static std::string filePrefix;
+static captureFormat fileFormat;
+
+static std::thread writer;
+static std::mutex queueLock;
+static std::condition_variable queueChanged;
+//ring of queued frames, oldest at jobsHead
+static CaptureJob jobs[MAXQUEUED];
+static int jobsHead = 0;
+static int jobsCount = 0;
+
+//buffers are kept with their capacity once created, so frames stop allocating
+static Pool<std::vector<unsigned char>, MAXBUFFERS> bufferPool;
+static std::vector<unsigned char>* freeBuffers[MAXBUFFERS];
+static int freeCount = 0;
+static bool stopping = false;
+
+#pragma region image writers
+
+static unsigned int crcTable[256];
+
+static void initCrcTable()
+{
+	for (unsigned int n = 0; n < 256; ++n){
+		unsigned int c = n;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crcTable[n] = c;
+	}
+}
+
+static unsigned int crc(unsigned int c, const unsigned char* data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+		c = crcTable[(c ^ data[i]) & 0xff] ^ (c >> 8);
+	return c;
+}
+
+static void putBE32(std::vector<unsigned char>& out, unsigned int v)
+{
+	out.push_back((unsigned char)(v >> 24));
+	out.push_back((unsigned char)(v >> 16));
+	out.push_back((unsigned char)(v >> 8));
+	out.push_back((unsigned char)v);
+}
+
+static void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size)
+{
+	putBE32(out, (unsigned int)size);
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	if (size)
+		out.insert(out.end(), data, data + size);
+	putBE32(out, crc(0xffffffffu, &out[start], size + 4) ^ 0xffffffffu);
+}
+
+//PNG with stored (uncompressed) deflate blocks, writing speed matters more than size here
+static bool writePNG(FILE* file, const unsigned char* pixels, int width, int height)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	std::vector<unsigned char> header;
+	putBE32(header, width);
+	putBE32(header, height);
+	header.push_back(8);	//bit depth
+	header.push_back(2);	//RGB
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	//filter byte + RGB for each row, top row first
+	size_t rowSize = 1 + width * 3;
+	std::vector<unsigned char> raw(rowSize * height);
+	for (int y = 0; y < height; ++y){
+		const unsigned char* src = pixels + (height - 1 - y) * width * 4;
+		unsigned char* dst = &raw[y * rowSize];
+		*dst++ = 0;
+		for (int x = 0; x < width; ++x, src += 4){
+			*dst++ = src[0];
+			*dst++ = src[1];
+			*dst++ = src[2];
+		}
+	}
+
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+
+	unsigned int a = 1, b = 0;
+	for (size_t pos = 0; pos < raw.size(); ){
+		size_t len = raw.size() - pos;
+		if (len > 65535)
+			len = 65535;
+
+		zlib.push_back(pos + len == raw.size() ? 1 : 0);
+		zlib.push_back((unsigned char)len);
+		zlib.push_back((unsigned char)(len >> 8));
+		zlib.push_back((unsigned char)~len);
+		zlib.push_back((unsigned char)(~len >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+
+		for (size_t i = pos; i < pos + len; ++i){
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		pos += len;
+	}
+	putBE32(zlib, (b << 16) | a);
+
+	std::vector<unsigned char> out;
+	out.reserve(zlib.size() + 64);
+	out.insert(out.end(), signature, signature + 8);
+	putChunk(out, "IHDR", &header[0], header.size());
+	putChunk(out, "IDAT", &zlib[0], zlib.size());
+	putChunk(out, "IEND", NULL, 0);
+
+	return fwrite(&out[0], 1, out.size(), file) == out.size();
+}
+
+static bool writePPM(FILE* file, const unsigned char* pixels, int width, int height)
+{
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+	std::vector<unsigned char> row(width * 3);
+	for (int y = height - 1; y >= 0; --y){
+		const unsigned char* src = pixels + y * width * 4;
+		for (int x = 0; x < width; ++x){
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		if (fwrite(&row[0], 1, row.size(), file) != row.size())
+			return false;
+	}
+	return true;
+}
+
+//raw RGBA, rows top to bottom
+static bool writeRaw(FILE* file, const unsigned char* pixels, int width, int height)
+{
+	for (int y = height - 1; y >= 0; --y){
+		if (fwrite(pixels + y * width * 4, 1, width * 4, file) != size_t(width * 4))
+			return false;
+	}
+	return true;
+}
+
+bool writeImage(const char* path, captureFormat format, const unsigned char* pixels, int width, int height)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file){
+		printf("Failed to open %s\n", path);
+		return false;
+	}
+
+	bool ok;
+	if (format == CAPTURE_PNG)
+		ok = writePNG(file, pixels, width, height);
+	else if (format == CAPTURE_PPM)
+		ok = writePPM(file, pixels, width, height);
+	else
+		ok = writeRaw(file, pixels, width, height);
+
+	fclose(file);
+
+	if (!ok)
+		printf("Failed to write %s\n", path);
+	return ok;
+}
+
+//image writers
+#pragma endregion
+
+static const char* extension(captureFormat format)
+{
+	if (format == CAPTURE_PNG)
+		return "png";
+	if (format == CAPTURE_PPM)
+		return "ppm";
+	return "rgba";
+}
+
+//writer thread, encodes frames in the order they were captured
+static void writerLoop()
+{
+	//encoding and file I/O allocate, on this thread's own schedule
+	AllocExempt exempt;
+	char path[512];
+
+	for (;;){
+		CaptureJob job;
+		{
+			std::unique_lock<std::mutex> lock(queueLock);
+			while (jobsCount == 0 && !stopping)
+				queueChanged.wait(lock);
+			if (jobsCount == 0)
+				return;
+			job = jobs[jobsHead];
+			jobsHead = (jobsHead + 1) % MAXQUEUED;
+			--jobsCount;
+			queueChanged.notify_all();
+		}
+
+		sprintf(path, "%s%04d.%s", filePrefix.c_str(), job.frame, extension(fileFormat));
+		writeImage(path, fileFormat, &(*job.pixels)[0], job.width, job.height);
+
+		std::lock_guard<std::mutex> lock(queueLock);
+		freeBuffers[freeCount++] = job.pixels;
+	}
+}
+
+//map a finished readback and hand the pixels to the writer thread
+static void retireSlot(CaptureSlot& slot)
+{
+	//ringSize - 1 frames have passed, so this rarely has to wait
+	glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	std::vector<unsigned char>* pixels = NULL;
+	{
+		std::unique_lock<std::mutex> lock(queueLock);
+		//back pressure when the disk cannot keep up
+		while (jobsCount >= MAXQUEUED)
+			queueChanged.wait(lock);
+		if (freeCount > 0)
+			pixels = freeBuffers[--freeCount];
+	}
+	if (!pixels)
+		pixels = bufferPool.create();
+	pixels->resize(slot.size);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+	if (mapped){
+		memcpy(&(*pixels)[0], mapped, slot.size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	CaptureJob job = { slot.frame, slot.width, slot.height, pixels };
+
+	std::lock_guard<std::mutex> lock(queueLock);
+	jobs[(jobsHead + jobsCount) % MAXQUEUED] = job;
+	++jobsCount;
+	queueChanged.notify_all();
+}
+
+bool initCapture(const char* prefix, captureFormat format, int ringSize)
+{
+	if (ringSize < 2)
+		ringSize = 2;
+
+	initCrcTable();
+
+	filePrefix = prefix;
+	fileFormat = format;
+	frameCount = 0;
+	nextSlot = 0;
+	stopping = false;
+
+	slots.resize(ringSize);
+	for (int i = 0; i < ringSize; ++i){
+		glGenBuffers(1, &slots[i].pbo);
+		slots[i].fence = 0;
+		slots[i].size = 0;
+	}
+
+	writer = std::thread(writerLoop);
+
+	return true;
+}
+
+void captureFrame(int width, int height)
+{
+	CaptureSlot& slot = slots[nextSlot];
+	nextSlot = (nextSlot + 1) % slots.size();
+
+	//this slot was filled slots.size() frames ago
+	if (slot.fence)
+		retireSlot(slot);
+
+	int size = width * height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (slot.size != size)
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frameCount++;
+	slot.width = width;
+	slot.height = height;
+	slot.size = size;
+}
+
+void finishCapture()
+{
+	if (slots.empty())
+		return;
+
+	//retire the remaining slots oldest first
+	for (size_t i = 0; i < slots.size(); ++i){
+		CaptureSlot& slot = slots[(nextSlot + i) % slots.size()];
+		if (slot.fence)
+			retireSlot(slot);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		stopping = true;
+		queueChanged.notify_all();
+	}
+	writer.join();
+
+	for (size_t i = 0; i < slots.size(); ++i)
+		glDeleteBuffers(1, &slots[i].pbo);
+	slots.clear();
+
+	for (int i = 0; i < freeCount; ++i)
+		bufferPool.destroy(freeBuffers[i]);
+	freeCount = 0;
+
+	printf("Captured %d frames to %s*.%s\n", frameCount, filePrefix.c_str(), extension(fileFormat));
+}
@@ -0,0 +1,26 @@
+#ifndef __CAPTURE__
+#define __CAPTURE__
+
+#include "openglutl.h"
+
+//asynchronous frame capture
+//each frame is read into one of a ring of pixel buffer objects, the buffer is
+//mapped ringSize - 1 frames later (when the GPU is long done with it) and the
+//pixels are handed to a background thread that writes the image files
+
+enum captureFormat{ CAPTURE_PNG, CAPTURE_PPM, CAPTURE_RAW };
+
+//start capturing to files named <prefix><frame number>.<ext>
+bool initCapture(const char* prefix, captureFormat format, int ringSize = 3);
+
+//queue a readback of the currently bound read framebuffer, call after display()
+//and before swapping buffers
+void captureFrame(int width, int height);
+
+//wait for every queued frame to be written, then stop the writer thread
+void finishCapture();
+
+//write one image synchronously, pixels are bottom-up RGBA as read by glReadPixels
+bool writeImage(const char* path, captureFormat format, const unsigned char* pixels, int width, int height);
+
+#endif //__CAPTURE__
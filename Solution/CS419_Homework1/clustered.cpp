@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cmath>
+#include "clustered.h"
+
+//must match cshaderClusters.glsl and fshaderClustered.glsl
+#define CLUSTERX 16
+#define CLUSTERY 16
+#define CLUSTERZ 24
+#define MAXCLUSTERLIGHTS 128
+
+static GLuint clusterProgram = 0;
+static GLint ClusterModelView;
+static GLint ClusterInvProjection;
+static GLint ClusterLightCount;
+
+static GLuint drawProgram = 0;
+static GLint DrawViewSize;
+
+//per cluster light count and fixed size index list
+static GLuint countBuffer = 0;
+static GLuint indexBuffer = 0;
+
+//clusters that touched more lights than they keep, read back once at shutdown
+static GLuint overflowBuffer = 0;
+static long long clusterFrames = 0;
+
+static GLuint createStorage(GLsizeiptr size)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return buffer;
+}
+
+void initClustered(GLuint program, float zNear, float zFar)
+{
+	drawProgram = program;
+
+	const int clusters = CLUSTERX * CLUSTERY * CLUSTERZ;
+	countBuffer = createStorage(clusters * sizeof(GLuint));
+	indexBuffer = createStorage(clusters * MAXCLUSTERLIGHTS * sizeof(GLuint));
+
+	GLuint zero[2] = { 0, 0 };
+	overflowBuffer = createStorage(sizeof(zero));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	clusterFrames = 0;
+
+	//slice = log(depth / zNear) * scale puts zFar at the end of the last slice
+	float scale = CLUSTERZ / log(zFar / zNear);
+
+	clusterProgram = InitComputeShader("cshaderClusters.glsl");
+	glUseProgram(clusterProgram);
+	ClusterModelView = glGetUniformLocation(clusterProgram, "ModelView");
+	ClusterInvProjection = glGetUniformLocation(clusterProgram, "InvProjection");
+	ClusterLightCount = glGetUniformLocation(clusterProgram, "LightCount");
+	glUniform1f(glGetUniformLocation(clusterProgram, "ClusterNear"), zNear);
+	glUniform1f(glGetUniformLocation(clusterProgram, "ClusterScale"), scale);
+
+	glUseProgram(drawProgram);
+	DrawViewSize = glGetUniformLocation(drawProgram, "ViewSize");
+	glUniform1f(glGetUniformLocation(drawProgram, "ClusterNear"), zNear);
+	glUniform1f(glGetUniformLocation(drawProgram, "ClusterScale"), scale);
+}
+
+void clusterLights(const mat4& modelView, const mat4& projection, GLuint lightBuffer, int lightCount,
+				   int width, int height)
+{
+	glUseProgram(clusterProgram);
+	glUniformMatrix4fv(ClusterModelView, 1, GL_TRUE, modelView);
+	glUniformMatrix4fv(ClusterInvProjection, 1, GL_TRUE, inverse(projection));
+	glUniform1i(ClusterLightCount, lightCount);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, indexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, overflowBuffer);
+	++clusterFrames;
+
+	//one work group per depth slice
+	glDispatchCompute(1, 1, CLUSTERZ);
+
+	//the fragment shader reads the lists back as storage buffers
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUseProgram(drawProgram);
+	glUniform2f(DrawViewSize, float(width), float(height));
+}
+
+void shutdownClustered()
+{
+	if (!clusterProgram)
+		return;
+
+	//the counts were written through a storage buffer
+	GLuint overflow[2];
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(overflow), overflow);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (overflow[0])
+		printf("Clustered: %u clusters over %lld frames touched more than %d lights (up to %u), the rest were not shaded\n",
+			   overflow[0], clusterFrames, MAXCLUSTERLIGHTS, overflow[1]);
+
+	glDeleteBuffers(1, &countBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteBuffers(1, &overflowBuffer);
+	glDeleteProgram(clusterProgram);
+	clusterProgram = 0;
+	overflowBuffer = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef __CLUSTERED__
+#define __CLUSTERED__
+
+#include "openglutl.h"
+
+//clustered forward shading for many point lights
+//the view frustum is split into a grid of clusters, a compute pass lists the lights
+//that reach each cluster and the forward shader loops over only its cluster's lights,
+//unlike deferred shading the scene is still drawn in one pass so MSAA keeps working
+//a cluster shades at most 128 lights, shutdownClustered reports clusters that touched more
+//needs OpenGL 4.3 for compute shaders and shader storage buffers
+
+//create the cluster buffers and the compute program, drawProgram is the forward
+//program built from vshaderClustered.glsl and fshaderClustered.glsl,
+//zNear and zFar are the depth range the slices are spread over
+void initClustered(GLuint drawProgram, float zNear, float zFar);
+
+//rebuild the light lists for this view, call before drawing with drawProgram
+void clusterLights(const mat4& modelView, const mat4& projection, GLuint lightBuffer, int lightCount,
+				   int width, int height);
+
+void shutdownClustered();
+
+#endif //__CLUSTERED__
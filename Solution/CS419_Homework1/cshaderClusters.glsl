@@ -0,0 +1,109 @@
+#version 430
+
+//builds the light list of every cluster for fshaderClustered.glsl
+//the view frustum is split into CLUSTERX x CLUSTERY tiles on screen and CLUSTERZ
+//slices in depth, one invocation per cluster tests every light sphere against the
+//cluster's eye space bounding box, the lights are staged through shared memory
+//a cluster keeps at most MAXCLUSTERLIGHTS lights, the rest are left out of its shading
+//and counted in Overflow so the host can report it
+
+#define CLUSTERX 16
+#define CLUSTERY 16
+#define CLUSTERZ 24
+#define MAXCLUSTERLIGHTS 128
+
+layout(local_size_x = CLUSTERX, local_size_y = CLUSTERY) in;
+
+struct PointLight{
+	vec4 position;	//w is the radius
+	vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Lights{
+	PointLight lights[];
+};
+
+layout(std430, binding = 1) writeonly buffer ClusterCounts{
+	uint clusterCounts[];
+};
+
+layout(std430, binding = 2) writeonly buffer ClusterLights{
+	uint clusterLights[];
+};
+
+//accumulated over every frame, cleared only when the buffer is created
+layout(std430, binding = 3) buffer Overflow{
+	uint overflowClusters;	//clusters that touched more than MAXCLUSTERLIGHTS lights
+	uint overflowPeak;		//most lights one cluster touched
+};
+
+uniform mat4 ModelView, InvProjection;
+uniform int LightCount;
+uniform float ClusterNear, ClusterScale;
+
+#define BATCH (CLUSTERX * CLUSTERY)
+shared vec4 batch[BATCH];	//eye space position and radius
+
+//eye space point of a tile corner at eye space depth z
+vec3 cornerAt(vec2 ndc, float z){
+	vec4 n = InvProjection * vec4(ndc, -1.0, 1.0);
+	vec4 f = InvProjection * vec4(ndc, 1.0, 1.0);
+	vec3 a = n.xyz / n.w;
+	vec3 b = f.xyz / f.w;
+	return mix(a, b, (z - a.z) / (b.z - a.z));
+}
+
+void main()
+{
+	uvec3 id = gl_GlobalInvocationID;
+	uint cluster = (id.z * CLUSTERY + id.y) * CLUSTERX + id.x;
+
+	//depth range of the slice, the inverse of the slice lookup in fshaderClustered.glsl
+	float zNear = -ClusterNear * exp(float(id.z) / ClusterScale);
+	float zFar = -ClusterNear * exp(float(id.z + 1) / ClusterScale);
+
+	vec2 lo = vec2(id.xy) / vec2(CLUSTERX, CLUSTERY) * 2.0 - 1.0;
+	vec2 hi = vec2(id.xy + 1) / vec2(CLUSTERX, CLUSTERY) * 2.0 - 1.0;
+
+	vec3 boxMin = vec3(1e30);
+	vec3 boxMax = vec3(-1e30);
+	for (int i = 0; i < 4; ++i){
+		vec2 ndc = vec2((i & 1) != 0 ? hi.x : lo.x, (i & 2) != 0 ? hi.y : lo.y);
+		vec3 a = cornerAt(ndc, zNear);
+		vec3 b = cornerAt(ndc, zFar);
+		boxMin = min(boxMin, min(a, b));
+		boxMax = max(boxMax, max(a, b));
+	}
+
+	uint count = 0u;
+	for (int first = 0; first < LightCount; first += BATCH){
+
+		//each invocation moves one light of the batch to eye space
+		int index = first + int(gl_LocalInvocationIndex);
+		if (index < LightCount){
+			vec4 light = lights[index].position;
+			batch[gl_LocalInvocationIndex] = vec4((ModelView * vec4(light.xyz, 1.0)).xyz, light.w);
+		}
+		barrier();
+
+		int batchCount = min(BATCH, LightCount - first);
+		for (int i = 0; i < batchCount; ++i){
+			vec4 light = batch[i];
+
+			//squared distance from the center to the box
+			vec3 d = max(max(boxMin - light.xyz, light.xyz - boxMax), 0.0);
+			if (dot(d, d) < light.w * light.w){
+				if (count < MAXCLUSTERLIGHTS)
+					clusterLights[cluster * MAXCLUSTERLIGHTS + count] = uint(first + i);
+				++count;
+			}
+		}
+		barrier();
+	}
+
+	if (count > MAXCLUSTERLIGHTS){
+		atomicAdd(overflowClusters, 1u);
+		atomicMax(overflowPeak, count);
+	}
+	clusterCounts[cluster] = min(count, uint(MAXCLUSTERLIGHTS));
+}
@@ -0,0 +1,67 @@
+#version 430
+
+//builds the sphere of genSphere straight into its vertex and element buffers
+//one invocation per grid vertex computes what genPoint does, and the vertices with
+//j > 0 also write the two triangles of the quad above them, in the order buildSphere uses
+
+layout(local_size_x = 64) in;
+
+//the planar layout genSphere uploads: positions (vec4), normals (vec3),
+//texture coordinates (vec2) and tangents (vec3) one after the other, tightly packed
+layout(std430, binding = 0) writeonly buffer Vertices{
+	float vertices[];
+};
+
+layout(std430, binding = 1) writeonly buffer Indices{
+	uint indices[];
+};
+
+//latitudes and longitudes
+uniform int M, N;
+
+#define M_PI 3.14159265358979323846
+
+
+void main()
+{
+	uint vertexCount = uint(N * (M + 1));
+	uint v = gl_GlobalInvocationID.x;
+	if (v >= vertexCount)
+		return;
+
+	int i = int(v) / (M + 1);
+	int j = int(v) % (M + 1);
+
+	float theta = M_PI * (float(j) / M);
+	float phi = 2.0 * M_PI * (float(i) / N);
+	vec3 nor = normalize(vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)));
+	vec2 tex = vec2(0.5 + atan(-nor.z, -nor.x) / (M_PI * 2.0), 0.5 - asin(-nor.y) / M_PI);
+
+	//tangent follows increasing u, fall back at the poles
+	vec3 tangent = vec3(-nor.z, 0.0, nor.x);
+	tangent = length(tangent) > 1e-6 ? normalize(tangent) : vec3(1.0, 0.0, 0.0);
+
+	uint p = v * 4;
+	uint n = vertexCount * 4 + v * 3;
+	uint t = vertexCount * 7 + v * 2;
+	uint g = vertexCount * 9 + v * 3;
+
+	vertices[p] = nor.x;  vertices[p + 1] = nor.y;  vertices[p + 2] = nor.z;  vertices[p + 3] = 1.0;
+	vertices[n] = nor.x;  vertices[n + 1] = nor.y;  vertices[n + 2] = nor.z;
+	vertices[t] = tex.x;  vertices[t + 1] = tex.y;
+	vertices[g] = tangent.x;  vertices[g + 1] = tangent.y;  vertices[g + 2] = tangent.z;
+
+	if (j == 0)
+		return;
+
+	uint column = uint(i * (M + 1));
+	uint next = uint(((i + 1) % N) * (M + 1));
+	uint k = uint((i * M + j - 1) * 6);
+
+	indices[k] = next + j;
+	indices[k + 1] = column + j;
+	indices[k + 2] = column + j - 1;
+	indices[k + 3] = next + j - 1;
+	indices[k + 4] = next + j;
+	indices[k + 5] = column + j - 1;
+}
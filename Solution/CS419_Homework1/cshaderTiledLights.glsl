@@ -0,0 +1,164 @@
+#version 430
+
+//tiled light pass of the deferred path
+//each work group is a 16x16 tile of pixels, it finds the depth range of its pixels,
+//keeps the lights whose sphere touches the tile's frustum and then shades its pixels
+//with only those, so the cost follows the lights that actually reach a pixel
+//a tile keeps at most MAXTILELIGHTS lights, the rest are left out of its shading and
+//counted in Overflow so the host can report it
+
+#define TILESIZE 16
+#define MAXTILELIGHTS 256
+
+layout(local_size_x = TILESIZE, local_size_y = TILESIZE) in;
+
+struct PointLight{
+	vec4 position;	//w is the radius
+	vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Lights{
+	PointLight lights[];
+};
+
+//accumulated over every frame, cleared only when the buffer is created
+layout(std430, binding = 1) buffer Overflow{
+	uint overflowTiles;		//tiles that touched more than MAXTILELIGHTS lights
+	uint overflowPeak;		//most lights one tile touched
+};
+
+layout(binding = 2) uniform sampler2D gAlbedo;
+layout(binding = 3) uniform sampler2D gNormal;
+layout(binding = 4) uniform sampler2D gDepth;
+layout(rgba8, binding = 0) uniform writeonly image2D lit;
+
+uniform mat4 ModelView, InvProjection;
+uniform int LightCount;
+uniform vec4 AmbientProduct, SpecularProduct, Background;
+uniform float Shininess;
+
+shared uint minDepth;
+shared uint maxDepth;
+shared uint tileCount;
+shared vec4 tilePlanes[4];
+shared float tileNear;
+shared float tileFar;
+shared vec4 tileLights[MAXTILELIGHTS];	//eye space position and radius
+shared uint tileColors[MAXTILELIGHTS];	//index to read the color from
+
+//eye space position of a window position in [0, 1] and a depth buffer value
+vec3 eyePosition(vec2 uv, float depth){
+	vec4 p = InvProjection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	return p.xyz / p.w;
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = textureSize(gDepth, 0);
+	bool inside = pixel.x < size.x && pixel.y < size.y;
+	float depth = inside ? texelFetch(gDepth, pixel, 0).r : 1.0;
+
+	if (gl_LocalInvocationIndex == 0){
+		minDepth = 0xffffffffu;
+		maxDepth = 0u;
+		tileCount = 0u;
+	}
+	barrier();
+
+	//depths are positive so their bits order like the floats, the background is left out
+	if (depth < 1.0){
+		atomicMin(minDepth, floatBitsToUint(depth));
+		atomicMax(maxDepth, floatBitsToUint(depth));
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0){
+		vec2 lo = vec2(gl_WorkGroupID.xy * TILESIZE) / vec2(size);
+		vec2 hi = vec2((gl_WorkGroupID.xy + 1) * TILESIZE) / vec2(size);
+
+		//the side planes pass through the eye and two corners of the tile
+		vec3 c00 = eyePosition(lo, 1.0);
+		vec3 c10 = eyePosition(vec2(hi.x, lo.y), 1.0);
+		vec3 c11 = eyePosition(hi, 1.0);
+		vec3 c01 = eyePosition(vec2(lo.x, hi.y), 1.0);
+		vec3 center = c00 + c10 + c11 + c01;
+
+		vec3 corners[5] = vec3[5](c00, c10, c11, c01, c00);
+		for (int i = 0; i < 4; ++i){
+			vec3 n = normalize(cross(corners[i], corners[i + 1]));
+			tilePlanes[i] = vec4(dot(n, center) < 0.0 ? -n : n, 0.0);
+		}
+
+		//eye space z decreases away from the eye
+		tileNear = eyePosition(lo, uintBitsToFloat(minDepth)).z;
+		tileFar = eyePosition(lo, uintBitsToFloat(maxDepth)).z;
+	}
+	barrier();
+
+	//an empty tile has nothing to light
+	if (minDepth <= maxDepth){
+		for (uint i = gl_LocalInvocationIndex; i < uint(LightCount); i += TILESIZE * TILESIZE){
+			vec4 light = lights[i].position;
+			vec3 c = (ModelView * vec4(light.xyz, 1.0)).xyz;
+			float r = light.w;
+
+			bool touches = c.z - r <= tileNear && c.z + r >= tileFar;
+			for (int p = 0; p < 4 && touches; ++p)
+				touches = dot(tilePlanes[p].xyz, c) >= -r;
+
+			if (touches){
+				uint slot = atomicAdd(tileCount, 1u);
+				if (slot < MAXTILELIGHTS){
+					tileLights[slot] = vec4(c, r);
+					tileColors[slot] = i;
+				}
+			}
+		}
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0 && tileCount > MAXTILELIGHTS){
+		atomicAdd(overflowTiles, 1u);
+		atomicMax(overflowPeak, tileCount);
+	}
+
+	if (!inside)
+		return;
+
+	if (depth >= 1.0){
+		imageStore(lit, pixel, Background);
+		return;
+	}
+
+	vec3 P = eyePosition((vec2(pixel) + 0.5) / vec2(size), depth);
+	vec3 N = normalize(texelFetch(gNormal, pixel, 0).xyz);
+	vec3 E = normalize(-P);
+	vec4 T = texelFetch(gAlbedo, pixel, 0);
+
+	vec3 color = (AmbientProduct * T).xyz;
+
+	uint count = min(tileCount, uint(MAXTILELIGHTS));
+	for (uint i = 0u; i < count; ++i){
+		vec3 toLight = tileLights[i].xyz - P;
+		float d = length(toLight);
+		float r = tileLights[i].w;
+		if (d >= r)
+			continue;
+
+		vec3 L = toLight / d;
+		float lDotN = dot(L, N);
+		if (lDotN <= 0.0)
+			continue;
+
+		//falls smoothly to zero at the radius so culling never cuts light off
+		float x = d / r;
+		float attenuation = (1.0 - x * x) * (1.0 - x * x);
+
+		vec3 H = normalize(L + E);
+		vec3 lightColor = lights[tileColors[i]].color.rgb;
+		color += attenuation * lightColor * (lDotN * T.rgb + pow(max(dot(N, H), 0.0), Shininess) * SpecularProduct.rgb);
+	}
+
+	imageStore(lit, pixel, vec4(color, 1.0));
+}
@@ -0,0 +1,190 @@
+#include <cstdio>
+#include <cstdlib>
+#include "deferred.h"
+
+//must match the local size and light cap of cshaderTiledLights.glsl
+#define TILESIZE 16
+#define MAXTILELIGHTS 256
+
+static GLint targetBuffer = 0;
+static GLuint gBuffer = 0;
+static GLuint albedoTexture = 0;
+static GLuint normalTexture = 0;
+static GLuint depthTexture = 0;
+
+//the compute shader writes an image, a framebuffer around it lets it be blitted
+static GLuint litTexture = 0;
+static GLuint litBuffer = 0;
+
+static GLuint lightProgram = 0;
+static GLint LightModelView;
+static GLint LightInvProjection;
+static GLint LightCount;
+
+//tiles that touched more lights than they keep, read back once at shutdown
+static GLuint overflowBuffer = 0;
+static long long lightFrames = 0;
+
+static int bufferWidth = 0;
+static int bufferHeight = 0;
+
+static GLuint createTexture(GLenum format, int width, int height)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+
+	//read with texelFetch only
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return texture;
+}
+
+static void createTargets(int width, int height)
+{
+	bufferWidth = width;
+	bufferHeight = height;
+
+	//keep the color texture bound on unit 0
+	glActiveTexture(GL_TEXTURE2);
+	albedoTexture = createTexture(GL_RGBA8, width, height);
+	normalTexture = createTexture(GL_RGBA16F, width, height);
+	depthTexture = createTexture(GL_DEPTH_COMPONENT24, width, height);
+	litTexture = createTexture(GL_RGBA8, width, height);
+	glActiveTexture(GL_TEXTURE0);
+
+	glGenFramebuffers(1, &gBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+	GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		printf("G-buffer is incomplete\n");
+		exit(EXIT_FAILURE);
+	}
+
+	glGenFramebuffers(1, &litBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, litBuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, litTexture, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targetBuffer);
+}
+
+static void deleteTargets()
+{
+	glDeleteFramebuffers(1, &gBuffer);
+	glDeleteFramebuffers(1, &litBuffer);
+	glDeleteTextures(1, &albedoTexture);
+	glDeleteTextures(1, &normalTexture);
+	glDeleteTextures(1, &depthTexture);
+	glDeleteTextures(1, &litTexture);
+}
+
+void initDeferred(int width, int height, const vec4& ambient, const vec4& specular,
+				  float shininess, const vec4& background)
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetBuffer);
+
+	lightProgram = InitComputeShader("cshaderTiledLights.glsl");
+	glUseProgram(lightProgram);
+
+	LightModelView = glGetUniformLocation(lightProgram, "ModelView");
+	LightInvProjection = glGetUniformLocation(lightProgram, "InvProjection");
+	LightCount = glGetUniformLocation(lightProgram, "LightCount");
+
+	glUniform4fv(glGetUniformLocation(lightProgram, "AmbientProduct"), 1, ambient);
+	glUniform4fv(glGetUniformLocation(lightProgram, "SpecularProduct"), 1, specular);
+	glUniform4fv(glGetUniformLocation(lightProgram, "Background"), 1, background);
+	glUniform1f(glGetUniformLocation(lightProgram, "Shininess"), shininess);
+
+	GLuint zero[2] = { 0, 0 };
+	glGenBuffers(1, &overflowBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), zero, GL_DYNAMIC_READ);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	lightFrames = 0;
+
+	createTargets(width, height);
+}
+
+void resizeDeferred(int width, int height)
+{
+	if (width == bufferWidth && height == bufferHeight)
+		return;
+
+	deleteTargets();
+	createTargets(width, height);
+}
+
+void deferredGeometryPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+
+	//alpha 0 albedo marks nothing, the light pass finds the background from depth anyway
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void deferredLightPass(const mat4& modelView, const mat4& projection, GLuint lightBuffer, int lightCount)
+{
+	GLint drawProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &drawProgram);
+
+	glUseProgram(lightProgram);
+	glUniformMatrix4fv(LightModelView, 1, GL_TRUE, modelView);
+	glUniformMatrix4fv(LightInvProjection, 1, GL_TRUE, inverse(projection));
+	glUniform1i(LightCount, lightCount);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, overflowBuffer);
+	++lightFrames;
+
+	//units 0 and 1 hold the color and bump textures of the geometry pass
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, albedoTexture);
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, normalTexture);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindImageTexture(0, litTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+	glDispatchCompute((bufferWidth + TILESIZE - 1) / TILESIZE, (bufferHeight + TILESIZE - 1) / TILESIZE, 1);
+
+	//the image writes have to land before the blit reads them
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, litBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetBuffer);
+	glBlitFramebuffer(0, 0, bufferWidth, bufferHeight, 0, 0, bufferWidth, bufferHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetBuffer);
+
+	glUseProgram(drawProgram);
+}
+
+void shutdownDeferred()
+{
+	if (!lightProgram)
+		return;
+
+	//the counts were written through a storage buffer
+	GLuint overflow[2];
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(overflow), overflow);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (overflow[0])
+		printf("Deferred: %u tiles over %lld frames touched more than %d lights (up to %u), the rest were not shaded\n",
+			   overflow[0], lightFrames, MAXTILELIGHTS, overflow[1]);
+
+	deleteTargets();
+	glDeleteBuffers(1, &overflowBuffer);
+	glDeleteProgram(lightProgram);
+	lightProgram = 0;
+	overflowBuffer = 0;
+}
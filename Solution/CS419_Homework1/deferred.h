@@ -0,0 +1,30 @@
+#ifndef __DEFERRED__
+#define __DEFERRED__
+
+#include "openglutl.h"
+
+//deferred shading for scenes with many point lights
+//the geometry pass writes albedo, eye space normal and depth into a G-buffer,
+//then a compute shader splits the screen into tiles, culls the lights against each
+//tile's depth range and shades every pixel with only the lights of its tile
+//a tile shades at most 256 lights, shutdownDeferred reports tiles that touched more
+//needs OpenGL 4.3 for compute shaders and shader storage buffers
+
+//create the G-buffer and the light pass program, the framebuffer bound now is
+//where lit frames end up, the material terms match the forward shaders
+void initDeferred(int width, int height, const vec4& ambient, const vec4& specular,
+				  float shininess, const vec4& background);
+
+//reallocate the G-buffer for a new viewport size
+void resizeDeferred(int width, int height);
+
+//bind and clear the G-buffer, draw the scene with the G-buffer program after this
+void deferredGeometryPass();
+
+//light the G-buffer with lightCount lights from lightBuffer and copy the result
+//to the target framebuffer, which is left bound
+void deferredLightPass(const mat4& modelView, const mat4& projection, GLuint lightBuffer, int lightCount);
+
+void shutdownDeferred();
+
+#endif //__DEFERRED__
@@ -0,0 +1,99 @@
+#version 430
+
+//Blinn-Phong of fshaderTexture.glsl and fshaderFinalTexture.glsl over the
+//lights of this fragment's cluster, which cshaderClusters.glsl fills each frame
+
+//must match cshaderClusters.glsl and clustered.cpp
+#define CLUSTERX 16
+#define CLUSTERY 16
+#define CLUSTERZ 24
+#define MAXCLUSTERLIGHTS 128
+
+struct PointLight{
+	vec4 position;	//w is the radius
+	vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Lights{
+	PointLight lights[];
+};
+
+layout(std430, binding = 1) readonly buffer ClusterCounts{
+	uint clusterCounts[];
+};
+
+layout(std430, binding = 2) readonly buffer ClusterLights{
+	uint clusterLights[];
+};
+
+uniform mat4 ModelView;
+uniform vec4 AmbientProduct, DiffuseProduct, SpecularProduct;
+uniform float Shininess;
+
+uniform sampler2D textureColor;
+uniform sampler2D textureBump;
+uniform bool BumpMapped;
+
+//cluster of a fragment, slices are spaced exponentially in depth
+uniform vec2 ViewSize;
+uniform float ClusterNear, ClusterScale;
+
+in vec3 P;
+in vec3 N;
+in vec3 T;
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void main()
+{
+	vec3 fN = normalize(N);
+
+	if (BumpMapped){
+		//the bump map normal is in the tangent frame of the surface
+		vec3 fT = normalize(T);
+		vec3 fB = cross(fN, fT);
+		vec3 bump = normalize(2.0 * texture(textureBump, texCoord).xyz - 1.0);
+		fN = normalize(bump.x * fT + bump.y * fB + bump.z * fN);
+	}
+
+	vec3 fE = normalize(-P);
+
+	//get texture color
+	vec4 tex = texture(textureColor, texCoord);
+
+	vec3 color = (AmbientProduct * tex).xyz;
+
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / ViewSize * vec2(CLUSTERX, CLUSTERY)), ivec2(0), ivec2(CLUSTERX - 1, CLUSTERY - 1));
+	int slice = clamp(int(log(max(-P.z, ClusterNear) / ClusterNear) * ClusterScale), 0, CLUSTERZ - 1);
+	uint cluster = uint((slice * CLUSTERY + tile.y) * CLUSTERX + tile.x);
+
+	uint count = min(clusterCounts[cluster], uint(MAXCLUSTERLIGHTS));
+	for (uint i = 0u; i < count; ++i){
+		PointLight light = lights[clusterLights[cluster * MAXCLUSTERLIGHTS + i]];
+
+		vec3 toLight = (ModelView * vec4(light.position.xyz, 1.0)).xyz - P;
+		float d = length(toLight);
+		float r = light.position.w;
+		if (d >= r)
+			continue;
+
+		vec3 fL = toLight / d;
+		float lDotN = dot(fL, fN);
+		if (lDotN <= 0.0)
+			continue;
+
+		//falls smoothly to zero at the radius so culling never cuts light off
+		float x = d / r;
+		float attenuation = (1.0 - x * x) * (1.0 - x * x);
+
+		vec3 fH = normalize(fL + fE);
+
+		vec3 diffuse  = lDotN * (DiffuseProduct * tex).xyz;
+		vec3 specular = pow(max(dot(fN, fH), 0.0), Shininess) * SpecularProduct.xyz;
+
+		color += attenuation * light.color.rgb * (diffuse + specular);
+	}
+
+	fragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,7 @@
+#version 130
+
+//the depth pre-pass writes depth only, color writes are masked off
+
+void main()
+{
+}
@@ -6,16 +6,25 @@ uniform float Shininess;
 uniform sampler2D textureColor;
 uniform sampler2D textureBump;
 
+//cube shadow map of the light, see shadow.h
+uniform samplerCubeShadow ShadowMap;
+uniform bool Shadowed;
+uniform float ShadowFar;
+
+//distance bias against self shadowing, in units of ShadowFar
+#define SHADOWBIAS 0.002
+
 in vec3 V;
 in vec3 L;
 in vec2 texCoord;
+in vec3 S;
 
 out vec4 fragColor;
 
 void main()
 {
 	//unpack out normal from bump map
-	vec3 N = texture2D(textureBump, texCoord).xyz;
+	vec3 N = texture(textureBump, texCoord).xyz;
 	vec3 fN = normalize( 2.0 * N - 1.0);
 
 	vec3 fL = normalize(L);
@@ -25,7 +34,7 @@ void main()
 	vec3 fH = normalize( fL + fV );
 
 	//get texture color
-	vec4 T = texture2D( textureColor, texCoord);
+	vec4 T = texture( textureColor, texCoord);
 
 	//compute phong illumination with the normal from the bump map
 	vec4 ambient  = AmbientProduct * T;
@@ -37,6 +46,14 @@ void main()
 		specular = vec4(0.0, 0.0, 0.0, 1.0);
 	}
 
+	//shadowed fragments keep only the ambient term
+	if (Shadowed)
+	{
+		float lit = texture(ShadowMap, vec4(S, length(S) / ShadowFar - SHADOWBIAS));
+		diffuse *= lit;
+		specular *= lit;
+	}
+
 	fragColor = vec4( (ambient + diffuse + specular).xyz, 1.0);
 
 	
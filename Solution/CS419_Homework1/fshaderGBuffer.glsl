@@ -0,0 +1,17 @@
+#version 430
+
+//writes the surface, lighting happens later in cshaderTiledLights.glsl
+
+uniform sampler2D textureColor;
+
+in vec3 N;
+in vec2 texCoord;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal;
+
+void main()
+{
+	albedo = texture(textureColor, texCoord);
+	normal = vec4(normalize(N), 0.0);
+}
@@ -0,0 +1,73 @@
+#version 130
+
+//ray casts the sphere of vshaderImpostor.glsl, exact silhouette, normal and depth,
+//then shades it like fshaderTexture.glsl with the texture mapping of genPoint
+
+uniform mat4 ModelView, Projection;
+uniform vec4 LightPosition, Rot;
+uniform vec4 AmbientProduct, DiffuseProduct, SpecularProduct;
+uniform float Shininess;
+
+uniform sampler2D textureColor;
+
+in vec3 P;
+flat in vec3 C;
+flat in float R;
+
+out vec4 fragColor;
+
+#define M_PI 3.14159265358979323846
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+void main()
+{
+	//the eye is at the origin, intersect the ray through this fragment with the sphere
+	vec3 D = normalize(P);
+	float b = dot(D, C);
+	float disc = b * b - dot(C, C) + R * R;
+	if (disc < 0.0)
+		discard;
+
+	vec3 X = (b - sqrt(disc)) * D;
+	vec3 fN = (X - C) / R;
+
+	vec4 clip = Projection * vec4(X, 1.0);
+	gl_FragDepth = 0.5 * clip.z / clip.w + 0.5;
+
+	//back to the sphere's own frame, undoing the view and then the trackball rotation
+	vec3 world = transpose(mat3(ModelView)) * fN;
+	vec3 n = q_rot(q_inverse(Rot), vec4(world, 0.0)).xyz;
+	vec2 texCoord = vec2(0.5 + atan(-n.z, -n.x) / (M_PI * 2.0), 0.5 - asin(-n.y) / M_PI);
+
+	vec3 fE = normalize(-X);
+	vec3 fL = (ModelView * LightPosition).xyz;
+	if (LightPosition.w != 0.0)
+		fL -= X;
+	fL = normalize(fL);
+	vec3 fH = normalize(fL + fE);
+
+	//get texture color
+	vec4 T = texture(textureColor, texCoord);
+
+	vec4 ambient  = AmbientProduct * T;
+	vec4 diffuse  = max(dot(fL, fN), 0.0) * DiffuseProduct * T;
+	vec4 specular = pow(max(dot(fN, fH), 0.0), Shininess) * SpecularProduct;
+
+	if( dot(fL, fN) < 0.0 )
+	{
+		specular = vec4(0.0, 0.0, 0.0, 1.0);
+	}
+
+	fragColor = vec4( (ambient + diffuse + specular).xyz, 1.0);
+}
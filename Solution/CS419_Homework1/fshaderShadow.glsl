@@ -0,0 +1,14 @@
+#version 150
+
+//stores the distance to the light scaled to [0, 1] instead of the projected depth
+//so the lookup only needs the direction and length of the light to fragment vector
+
+uniform vec4 LightPosition;
+uniform float ShadowFar;
+
+in vec3 fragPosition;
+
+void main()
+{
+	gl_FragDepth = length(fragPosition - LightPosition.xyz) / ShadowFar;
+}
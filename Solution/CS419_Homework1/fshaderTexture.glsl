@@ -5,10 +5,19 @@ uniform float Shininess;
 
 uniform sampler2D textureColor;
 
+//cube shadow map of the light, see shadow.h
+uniform samplerCubeShadow ShadowMap;
+uniform bool Shadowed;
+uniform float ShadowFar;
+
+//distance bias against self shadowing, in units of ShadowFar
+#define SHADOWBIAS 0.002
+
 in vec3 N;
 in vec3 E;
 in vec3 L;
 in vec2 texCoord;
+in vec3 S;
 
 out vec4 fragColor;
 
@@ -33,6 +42,14 @@ void main()
 		specular = vec4(0.0, 0.0, 0.0, 1.0);
 	}
 
+	//shadowed fragments keep only the ambient term
+	if (Shadowed)
+	{
+		float lit = texture(ShadowMap, vec4(S, length(S) / ShadowFar - SHADOWBIAS));
+		diffuse *= lit;
+		specular *= lit;
+	}
+
 	fragColor = vec4( (ambient + diffuse + specular).xyz, 1.0);
 
 	
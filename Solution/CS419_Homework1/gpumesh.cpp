@@ -0,0 +1,61 @@
+#include "gpumesh.h"
+
+//must match cshaderSphere.glsl
+#define SPHEREGROUP 64
+
+//floats per vertex over the four arrays, vec4 + vec3 + vec2 + vec3
+#define SPHEREFLOATS 12
+
+static GLuint sphereProgram = 0;
+static GLint SphereM;
+static GLint SphereN;
+
+void initSphereCompute()
+{
+	sphereProgram = InitComputeShader("cshaderSphere.glsl");
+	SphereM = glGetUniformLocation(sphereProgram, "M");
+	SphereN = glGetUniformLocation(sphereProgram, "N");
+}
+
+int sphereVertexCount(int m, int n)
+{
+	return n * (m + 1);
+}
+
+int sphereIndexCount(int m, int n)
+{
+	return n * m * 6;
+}
+
+void computeSphere(int m, int n, GLuint vertexBuffer, GLuint indexBuffer)
+{
+	int vertexCount = sphereVertexCount(m, n);
+
+	//fresh storage, nothing is copied from the CPU
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, vertexCount * SPHEREFLOATS * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sphereIndexCount(m, n) * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(sphereProgram);
+	glUniform1i(SphereM, m);
+	glUniform1i(SphereN, n);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vertexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, indexBuffer);
+
+	glDispatchCompute((vertexCount + SPHEREGROUP - 1) / SPHEREGROUP, 1, 1);
+
+	//the buffers are read next as vertex attributes and indices
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+
+	glUseProgram(0);
+}
+
+void shutdownSphereCompute()
+{
+	if (sphereProgram)
+		glDeleteProgram(sphereProgram);
+	sphereProgram = 0;
+}
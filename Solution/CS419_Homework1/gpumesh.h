@@ -0,0 +1,24 @@
+#ifndef __GPU_MESH__
+#define __GPU_MESH__
+
+#include "openglutl.h"
+
+//sphere generation on the GPU with cshaderSphere.glsl
+//the compute shader writes the vertex and element buffers genSphere would upload,
+//in the same planar layout, so a new resolution costs a dispatch and no transfer
+//the vertices are left in grid order, the cache optimization of meshopt.h is CPU only
+//needs OpenGL 4.3 for compute shaders and shader storage buffers
+
+void initSphereCompute();
+
+//vertex and index counts of an m x n sphere
+int sphereVertexCount(int m, int n);
+int sphereIndexCount(int m, int n);
+
+//(re)allocate vertexBuffer and indexBuffer and fill them with an m x n sphere,
+//leaves no program in use
+void computeSphere(int m, int n, GLuint vertexBuffer, GLuint indexBuffer);
+
+void shutdownSphereCompute();
+
+#endif //__GPU_MESH__
@@ -0,0 +1,37 @@
+#version 150
+
+//layered rendering, each triangle goes to every cube face it can land on
+//so all six faces of the shadow map are drawn in one pass
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 18) out;
+
+uniform mat4 ShadowMatrices[6];
+
+in vec3 worldPosition[];
+
+out vec3 fragPosition;
+
+void main()
+{
+	for (int face = 0; face < 6; ++face){
+		vec4 p[3];
+		for (int i = 0; i < 3; ++i)
+			p[i] = ShadowMatrices[face] * vec4(worldPosition[i], 1.0);
+
+		//skip the face if the whole triangle is outside one of its side planes
+		vec4 outside = vec4(1.0);
+		for (int i = 0; i < 3; ++i)
+			outside *= vec4(lessThan(vec4(p[i].x, -p[i].x, p[i].y, -p[i].y), vec4(-p[i].w)));
+		if (any(notEqual(outside, vec4(0.0))))
+			continue;
+
+		for (int i = 0; i < 3; ++i){
+			gl_Layer = face;
+			fragPosition = worldPosition[i];
+			gl_Position = p[i];
+			EmitVertex();
+		}
+		EndPrimitive();
+	}
+}
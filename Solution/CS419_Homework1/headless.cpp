@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <cstring>
+#include "headless.h"
+
+#ifndef _WIN32
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+static EGLSurface surface = EGL_NO_SURFACE;
+#endif
+
+static GLuint frameBuffer = 0;
+static GLuint colorBuffer = 0;
+static GLuint depthBuffer = 0;
+
+//multisampled targets are resolved into this one before they are read
+static GLuint resolveBuffer = 0;
+static GLuint resolveColor = 0;
+static int targetWidth = 0;
+static int targetHeight = 0;
+
+bool initHeadless()
+{
+#ifdef _WIN32
+	printf("Headless rendering needs EGL, which is not available on this platform\n");
+	return false;
+#else
+	//prefer Mesa's surfaceless platform so no X or GBM device is needed
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)){
+		printf("EGL initialization failed: 0x%x\n", eglGetError());
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)){
+		printf("EGL does not support desktop OpenGL\n");
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLConfig config = NULL;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+	//no context version is requested so we get a compatibility profile like GLFW does
+	context = eglCreateContext(display, numConfigs ? config : NULL, EGL_NO_CONTEXT, NULL);
+	if (context == EGL_NO_CONTEXT){
+		printf("EGL context creation failed: 0x%x\n", eglGetError());
+		return false;
+	}
+
+	//everything is drawn into our own framebuffer object, so only fall back
+	//to a tiny pbuffer when surfaceless contexts are not supported
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")){
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+	}
+
+	if (!eglMakeCurrent(display, surface, surface, context)){
+		printf("EGL make current failed: 0x%x\n", eglGetError());
+		return false;
+	}
+
+	printf("Headless renderer: %s\n", glGetString(GL_RENDERER));
+
+	return true;
+#endif
+}
+
+bool createHeadlessTarget(int width, int height, int samples)
+{
+	targetWidth = width;
+	targetHeight = height;
+
+	//0 samples is a plain single sampled target
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+
+	if (samples > 1){
+		glGenRenderbuffers(1, &resolveColor);
+		glBindRenderbuffer(GL_RENDERBUFFER, resolveColor);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+		glGenFramebuffers(1, &resolveBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, resolveBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColor);
+	}
+
+	glGenFramebuffers(1, &frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		printf("Headless framebuffer is incomplete\n");
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+
+	return true;
+}
+
+void resolveHeadlessTarget()
+{
+	if (!resolveBuffer)
+		return;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveBuffer);
+	glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	//keep drawing into the multisampled target, reads come from the resolved copy
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveBuffer);
+}
+
+void shutdownHeadless()
+{
+	glDeleteFramebuffers(1, &frameBuffer);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	if (resolveBuffer){
+		glDeleteFramebuffers(1, &resolveBuffer);
+		glDeleteRenderbuffers(1, &resolveColor);
+	}
+
+#ifndef _WIN32
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface != EGL_NO_SURFACE)
+		eglDestroySurface(display, surface);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+#endif
+}
@@ -0,0 +1,22 @@
+#ifndef __HEADLESS__
+#define __HEADLESS__
+
+#include "openglutl.h"
+
+//offscreen rendering without a window or display, for batch jobs and CI
+//uses a surfaceless EGL context (Mesa llvmpipe works without a GPU)
+
+//create and make current an OpenGL context with no window, call before glewInit
+bool initHeadless();
+
+//create the framebuffer object frames are rendered into, call after glewInit
+//samples above 1 make it multisampled
+bool createHeadlessTarget(int width, int height, int samples = 0);
+
+//resolve a multisampled target and leave the result bound for reading,
+//does nothing for a single sampled one
+void resolveHeadlessTarget();
+
+void shutdownHeadless();
+
+#endif //__HEADLESS__
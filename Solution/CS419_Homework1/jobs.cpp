@@ -0,0 +1,358 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <condition_variable>
+#include "jobs.h"
+#ifndef MATH_ONLY
+#include "profiler.h"
+#endif
+
+//jobs a deque holds, a full deque runs the next job on the spot
+#define DEQUESIZE 4096
+//pieces of a parallelFor, a few per thread even out uneven work
+#define MAXPIECES 256
+#define PIECESPERTHREAD 4
+//tries to find work before a worker goes to sleep
+#define IDLESPINS 64
+
+//Chase-Lev deque with a fixed ring (Le et al., Correct and Efficient Work-Stealing for
+//Weak Memory Models), the owner pushes and pops at bottom, thieves take from top
+struct JobDeque{
+	std::atomic<long long>	top;
+	char					pad0[64];
+	std::atomic<long long>	bottom;
+	char					pad1[64];
+	Job						jobs[DEQUESIZE];
+
+	JobDeque() : top(0), bottom(0) {}
+};
+
+//owner only
+static bool pushJob(JobDeque& q, const Job& job)
+{
+	long long b = q.bottom.load(std::memory_order_relaxed);
+	long long t = q.top.load(std::memory_order_acquire);
+	if (b - t >= DEQUESIZE)
+		return false;
+
+	q.jobs[b & (DEQUESIZE - 1)] = job;
+	q.bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+//owner only, newest first
+static bool popJob(JobDeque& q, Job& job)
+{
+	long long b = q.bottom.load(std::memory_order_relaxed) - 1;
+	q.bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = q.top.load(std::memory_order_relaxed);
+
+	if (t > b){
+		q.bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	job = q.jobs[b & (DEQUESIZE - 1)];
+	if (t == b){
+		//the last job, a thief may be after it too
+		bool won = q.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		q.bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+//any thread, oldest first
+static bool stealJob(JobDeque& q, Job& job)
+{
+	long long t = q.top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = q.bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return false;
+
+	job = q.jobs[t & (DEQUESIZE - 1)];
+	return q.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+static bool running = false;
+static int threadCount = 1;
+static JobDeque* deques = NULL;
+static std::vector<std::thread> workers;
+
+//deque of the current thread, -1 for threads outside the system
+static thread_local int threadSlot = -1;
+
+//jobs from outside threads
+static std::mutex sharedLock;
+static std::vector<Job> sharedJobs;
+static std::atomic<int> sharedCount(0);
+
+//idle workers sleep until a job is queued
+static std::atomic<int> queued(0);
+static std::atomic<int> sleepers(0);
+static std::atomic<bool> stopping(false);
+static std::mutex sleepLock;
+static std::condition_variable wake;
+
+static void executeJob(const Job& job);
+
+static void queueJob(const Job& job)
+{
+	if (threadSlot >= 0){
+		if (!pushJob(deques[threadSlot], job)){
+			executeJob(job);
+			return;
+		}
+	}
+	else{
+		std::lock_guard<std::mutex> lock(sharedLock);
+		sharedJobs.push_back(job);
+		sharedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//pairs with the check in workerLoop, one of the two sees the other
+	queued.fetch_add(1, std::memory_order_seq_cst);
+	if (sleepers.load(std::memory_order_seq_cst) > 0){
+		std::lock_guard<std::mutex> lock(sleepLock);
+		wake.notify_one();
+	}
+}
+
+static bool findJob(Job& job)
+{
+	bool found = false;
+	if (threadSlot >= 0)
+		found = popJob(deques[threadSlot], job);
+
+	if (!found && sharedCount.load(std::memory_order_relaxed) > 0){
+		std::lock_guard<std::mutex> lock(sharedLock);
+		if (!sharedJobs.empty()){
+			job = sharedJobs.back();
+			sharedJobs.pop_back();
+			sharedCount.fetch_sub(1, std::memory_order_relaxed);
+			found = true;
+		}
+	}
+
+	//start with the next thread over so thieves spread out
+	for (int i = 1; i <= threadCount && !found; ++i){
+		int victim = (threadSlot + i + threadCount) % threadCount;
+		if (victim != threadSlot)
+			found = stealJob(deques[victim], job);
+	}
+
+	if (found)
+		queued.fetch_sub(1, std::memory_order_relaxed);
+	return found;
+}
+
+static void finishJob(JobCounter* counter)
+{
+	Job released[MAXDEPENDENTS];
+	int count = 0;
+	{
+		std::lock_guard<std::mutex> lock(counter->lock);
+		if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+			count = counter->dependentCount;
+			for (int i = 0; i < count; ++i)
+				released[i] = counter->dependents[i];
+			counter->dependentCount = 0;
+		}
+	}
+
+	for (int i = 0; i < count; ++i){
+		if (running)
+			queueJob(released[i]);
+		else
+			executeJob(released[i]);
+	}
+}
+
+static void executeJob(const Job& job)
+{
+#ifndef MATH_ONLY
+	if (job.name && profilerEnabled){
+		double start = profileNow();
+		job.func(job.data);
+		profileRecord(job.name, start, profileNow());
+	}
+	else
+#endif
+		job.func(job.data);
+
+	if (job.counter)
+		finishJob(job.counter);
+}
+
+static void workerLoop(int slot)
+{
+	threadSlot = slot;
+	int idle = 0;
+	Job job;
+
+	while (!stopping.load(std::memory_order_relaxed)){
+		if (findJob(job)){
+			executeJob(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < IDLESPINS){
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepLock);
+		sleepers.fetch_add(1, std::memory_order_seq_cst);
+		while (queued.load(std::memory_order_seq_cst) <= 0 && !stopping.load())
+			wake.wait(lock);
+		sleepers.fetch_sub(1, std::memory_order_seq_cst);
+		idle = 0;
+	}
+}
+
+void initJobs(int count)
+{
+	if (running)
+		return;
+
+	if (count <= 0)
+		count = std::thread::hardware_concurrency();
+	if (count <= 0)
+		count = 1;
+
+	//the threads are joined before the statics they use go away
+	static bool registered = false;
+	if (!registered){
+		atexit(shutdownJobs);
+		registered = true;
+	}
+
+	threadCount = count;
+	deques = new JobDeque[count];
+	sharedJobs.reserve(DEQUESIZE);
+	queued = 0;
+	stopping = false;
+	running = true;
+
+	threadSlot = 0;
+	for (int t = 1; t < count; ++t)
+		workers.push_back(std::thread(workerLoop, t));
+}
+
+void shutdownJobs()
+{
+	if (!running)
+		return;
+
+	//whatever is still queued runs here first
+	Job job;
+	while (findJob(job))
+		executeJob(job);
+
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+		stopping = true;
+		wake.notify_all();
+	}
+	for (size_t t = 0; t < workers.size(); ++t)
+		workers[t].join();
+	workers.clear();
+
+	running = false;
+	threadSlot = -1;
+	threadCount = 1;
+	delete[] deques;
+	deques = NULL;
+}
+
+int jobThreads()
+{
+	return threadCount;
+}
+
+void runJob(JobFunc func, void* data, JobCounter* counter, const char* name, JobCounter* after)
+{
+	Job job = { func, data, counter, name };
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (after){
+		std::lock_guard<std::mutex> lock(after->lock);
+		if (after->pending.load(std::memory_order_acquire) > 0){
+			if (after->dependentCount == MAXDEPENDENTS){
+				printf("More than %d jobs wait for one counter\n", MAXDEPENDENTS);
+				exit(EXIT_FAILURE);
+			}
+			after->dependents[after->dependentCount++] = job;
+			return;
+		}
+	}
+
+	if (running)
+		queueJob(job);
+	else
+		executeJob(job);
+}
+
+void waitJobs(JobCounter* counter)
+{
+	Job job;
+	while (counter->pending.load(std::memory_order_acquire) > 0){
+		if (running && findJob(job))
+			executeJob(job);
+		else
+			std::this_thread::yield();
+	}
+
+	//the last job may still be releasing the counter's dependents
+	std::lock_guard<std::mutex> lock(counter->lock);
+}
+
+struct ForPiece{
+	JobRangeFunc	func;
+	void*			data;
+	int				begin;
+	int				end;
+};
+
+static void runPiece(void* data)
+{
+	ForPiece* piece = (ForPiece*)data;
+	piece->func(piece->begin, piece->end, piece->data);
+}
+
+void parallelFor(int begin, int end, int grain, JobRangeFunc func, void* data, const char* name)
+{
+	int count = end - begin;
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	int pieces = (count + grain - 1) / grain;
+	if (pieces > threadCount * PIECESPERTHREAD)
+		pieces = threadCount * PIECESPERTHREAD;
+	if (pieces > MAXPIECES)
+		pieces = MAXPIECES;
+
+	ForPiece piece[MAXPIECES];
+	JobCounter counter;
+	for (int p = 0; p < pieces; ++p){
+		piece[p].func = func;
+		piece[p].data = data;
+		piece[p].begin = begin + int((long long)count * p / pieces);
+		piece[p].end = begin + int((long long)count * (p + 1) / pieces);
+	}
+
+	//queued last first, so the owner pops them in order and thieves take the far end
+	for (int p = pieces - 1; p > 0; --p)
+		runJob(runPiece, &piece[p], &counter, name);
+
+	Job first = { runPiece, &piece[0], NULL, name };
+	executeJob(first);
+	waitJobs(&counter);
+}
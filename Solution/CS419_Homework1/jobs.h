@@ -0,0 +1,57 @@
+#ifndef __JOBS__
+#define __JOBS__
+
+#include <atomic>
+#include <mutex>
+
+//work-stealing job system
+//every thread has a deque of jobs, it pushes and pops its own end and idle threads
+//steal from the other end, threads outside the system (render thread, capture writer)
+//submit through a shared queue
+//a job is a function pointer and its argument, both must stay valid until it has run
+//before initJobs or after shutdownJobs every job simply runs on the submitting thread
+
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(int begin, int end, void* data);
+
+struct JobCounter;
+
+struct Job{
+	JobFunc		func;
+	void*		data;
+	JobCounter*	counter;	//decremented once the job has run, may be NULL
+	const char*	name;		//profiler scope of the job, a string literal or NULL
+};
+
+//jobs one counter can hold back at a time
+#define MAXDEPENDENTS 16
+
+//counts the unfinished jobs submitted with it, waitJobs returns once it is zero
+//jobs submitted after it are held back until then, it must outlive all of them
+struct JobCounter{
+	std::atomic<int>	pending;
+	std::mutex			lock;
+	Job					dependents[MAXDEPENDENTS];
+	int					dependentCount;
+
+	JobCounter() : pending(0), dependentCount(0) {}
+};
+
+//start threadCount - 1 workers next to the calling thread, 0 for one thread per core
+void initJobs(int threadCount);
+void shutdownJobs();
+
+//threads that run jobs, the caller of initJobs included, 1 when not started
+int jobThreads();
+
+//queue func(data), after may be NULL or a counter to wait for first
+void runJob(JobFunc func, void* data, JobCounter* counter, const char* name = NULL, JobCounter* after = NULL);
+
+//run other jobs until counter reaches zero
+void waitJobs(JobCounter* counter);
+
+//func over [begin, end) in pieces of at least grain, returns when all of them are done
+//the calling thread takes the first piece
+void parallelFor(int begin, int end, int grain, JobRangeFunc func, void* data, const char* name = NULL);
+
+#endif //__JOBS__
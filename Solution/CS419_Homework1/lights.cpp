@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include "lights.h"
+
+//radius of the scene light, far past anything it could reach
+#define MAINRADIUS 1000.0f
+
+static float randomRange(float lo, float hi)
+{
+	return lo + (hi - lo) * (rand() / float(RAND_MAX));
+}
+
+void genLights(int count, const vec4& mainLight, std::vector<PointLight>& lights)
+{
+	lights.clear();
+	if (count < 1)
+		return;
+
+	PointLight light;
+	light.position = vec4(mainLight.x, mainLight.y, mainLight.z, MAINRADIUS);
+	light.color = vec4(1.0, 1.0, 1.0, 0.0);
+	lights.push_back(light);
+
+	//same lights every run so images and timings compare
+	srand(419);
+
+	for (int i = 1; i < count; ++i){
+		//the lattice fills x and y in [-1, 1] and reaches back to z = -2
+		light.position = vec4(randomRange(-1.2f, 1.2f), randomRange(-1.2f, 1.2f), randomRange(-2.0f, 0.6f),
+							  randomRange(0.3f, 0.6f));
+
+		//saturated colors, one channel kept low
+		vec4 color(randomRange(0.2f, 1.0f), randomRange(0.2f, 1.0f), randomRange(0.2f, 1.0f), 0.0);
+		color[rand() % 3] = 0.1f;
+		light.color = color;
+
+		lights.push_back(light);
+	}
+}
+
+GLuint createLightBuffer(const std::vector<PointLight>& lights)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lights.size() * sizeof(PointLight), lights.empty() ? NULL : &lights[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return buffer;
+}
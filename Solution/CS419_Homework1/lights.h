@@ -0,0 +1,22 @@
+#ifndef __LIGHTS__
+#define __LIGHTS__
+
+#include <vector>
+#include "openglutl.h"
+
+//point lights for the many-light shading paths, stored in a shader storage buffer
+//the layout matches the PointLight struct of the shaders under std430
+
+struct PointLight{
+	vec4	position;	//world space, w is the radius past which the light adds nothing
+	vec4	color;		//rgb, w unused
+};
+
+//light 0 is the scene light mainLight with a radius that covers everything,
+//the rest are scattered through the instance lattice with random colors
+void genLights(int count, const vec4& mainLight, std::vector<PointLight>& lights);
+
+//upload lights into a new shader storage buffer
+GLuint createLightBuffer(const std::vector<PointLight>& lights);
+
+#endif //__LIGHTS__
@@ -1,6 +1,30 @@
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
+#include <algorithm>
 #include "openglutl.h"
+#include "bumpmap.h"
+#include "headless.h"
+#include "capture.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "trackball.h"
+#include "timestep.h"
+#include "renderthread.h"
+#include "softraster.h"
+#include "overdraw.h"
+#include "lights.h"
+#include "deferred.h"
+#include "clustered.h"
+#include "shadow.h"
+#include "meshopt.h"
+#include "gpumesh.h"
+#include "tvec.h"
+#include "simdmath.h"
+#include "jobs.h"
+#include "arena.h"
 #include "SOIL.h"
 
 typedef vec4  color4;
@@ -32,10 +56,20 @@ GLuint SpecularProduct;
 GLuint LightPosition;
 GLuint Shininess;
 GLuint Rot;
+GLuint ViewSize;
 
 //program
 GLuint program;
 
+//depth pre-pass program and its uniforms
+GLuint depthProgram = 0;
+GLuint DepthModelView;
+GLuint DepthProjection;
+GLuint DepthRot;
+
+//shadow caster program, owned by shadow.cpp
+GLuint shadowProgram = 0;
+
 //Gluints
 #pragma endregion
 
@@ -46,6 +80,9 @@ mat4  mv, proj;
 
 vec4 rot;
 
+//rotation at the previous simulation step and the blend of the two that is drawn
+vec4 prevRot, drawRot;
+
 //matrices
 #pragma endregion 
 
@@ -66,12 +103,89 @@ bool buttonHeld = false;
 
 bool velocity = false;
 
+//momentum spin, in the trackball speed units per second
+#define SPINRATE 0.6
+
+Timestep simClock;
+
+//frame rate cap (-fps, 0 is uncapped) and swap interval (-vsync)
+int frameCap = 0;
+int swapInterval = 1;
+
+//draw on a separate render thread that owns the GL context (-threaded)
+bool threaded = false;
+
+//threads of the job system, 0 for one per core (-jobs)
+int jobThreadCount = 0;
+
+//fail if a frame after the first few allocates on the heap (-checkalloc)
+bool checkAlloc = false;
+#define CHECKALLOCWARMUP 10
+
+//render one frame on the CPU into this file instead, no GL needed (-soft)
+const char* softPath = NULL;
+
+//number of spheres drawn outside of benchmarks (-instances)
+int startInstances = 1;
+
+//lay depth down in a position only pass before shading (-prepass),
+//draw the instances nearest first (-sort) and count shaded fragments (-overdraw)
+bool prepass = false;
+bool frontToBack = false;
+bool overdrawStats = false;
+
+//shade with this many point lights through the deferred path (-deferred)
+//or the clustered forward path (-clustered)
+int deferredLights = 0;
+int clusteredLights = 0;
+
+//samples per pixel of the window or offscreen target (-msaa)
+int msaaSamples = 0;
+
+//cube shadow map for the point light (-shadows)
+bool shadows = false;
+
+//draw every sphere as a ray cast quad instead of a mesh (-impostors)
+bool impostors = false;
+
+//refine a base octahedron on the GPU until edges are this many pixels long (-tessellate)
+float tessEdge = 0;
+
+//use the bump mapped shaders (-bump)
+bool bumpMapped = false;
+
+//render this many frames offscreen instead of opening a window (-headless)
+int headlessFrames = 0;
+
+//write every frame to <prefix>NNNN.<format> (-out, -format)
+//-headless without -out keeps writing frameNNNN.ppm
+const char* capturePrefix = NULL;
+captureFormat captureType = CAPTURE_PNG;
+#define HEADLESSPREFIX "frame"
+
+//frame timing report (-profile) and chrome trace output (-trace)
+bool profiling = false;
+const char* tracePath = NULL;
+
+//replay the scripted benchmark path instead of taking input (-bench)
+bool benchmarking = false;
+bool windowedBench = false;
+BenchConfig benchConfig;
+
 int screenWidth  = 512;
 int screenHeight = 512;
 
+//size the viewport was last set to, on the thread that draws
+int viewWidth = 0;
+int viewHeight = 0;
+
 double xPrev, yPrev;
 double xCur, yCur;
 
+//cursor events are coalesced, the drag is applied once per frame from here to xCur, yCur
+double dragX, dragY;
+bool dragPending = false;
+
 //ui elements
 #pragma endregion 
 
@@ -82,7 +196,17 @@ double xCur, yCur;
 #define PLANESPE vec4(1.0, 1.0, 1.0, 1.0)
 #define PLANESHI 10
 
-GLuint sphereVao;
+GLuint sphereVao = 0;
+GLuint depthVao = 0;
+GLuint shadowVao = 0;
+GLuint impostorVao = 0;
+GLuint tessVao = 0;
+GLuint sphereBuffer = 0;
+GLuint sphereIndexBuffer = 0;
+GLuint instanceBuffer = 0;
+
+//bumped whenever the meshes or placements of the shadow casters change
+int casterVersion = 0;
 
 // object properties
 #pragma endregion
@@ -95,6 +219,22 @@ point4 lightPos =  point4( 0.0, 0.0, 2.0, 1.0 );
 #define LIGHTAMB color4( 0.2, 0.2, 0.2, 1.0 )
 #define LIGHTDIF color4( 1.0, 1.0, 1.0, 1.0 )
 #define LIGHTSPE color4( 1.0, 1.0, 1.0, 1.0 )
+#define LIGHTSHI 30000.0
+
+#define BACKGROUND color4( 1.0, 1.0, 1.0, 1.0 )
+
+//how far a key press moves the light
+#define LIGHTSTEP 0.1f
+
+#define SHADOWSIZE 1024
+#define SHADOWFAR 10.0f
+#define SHADOWUNIT 5
+
+//light position the shaders were last given, on the thread that draws
+point4 drawLight;
+
+std::vector<PointLight> lights;
+GLuint lightBuffer = 0;
 
 //lighting
 #pragma endregion 
@@ -102,14 +242,41 @@ point4 lightPos =  point4( 0.0, 0.0, 2.0, 1.0 );
 #pragma region sphere
 
 int NumVertices = 0;
+int NumIndices = 0;
 
 std::vector<vec4> points;
 std::vector<vec3> normals;
 std::vector<vec2> tex_coord;
+std::vector<vec3> tangents;
+std::vector<GLuint> indices;
+
+//reorder the sphere for the vertex cache (on unless -no-meshopt)
+bool meshOptimize = true;
+
+//generate the sphere with a compute shader instead of uploading it (-gpumesh)
+bool gpuMesh = false;
+
+//upload the sphere attributes as half floats (-halfverts)
+bool halfVertices = false;
+
+//resolution the +/- keys ask for, and the one the sphere buffers hold
+int sphereM = 40, sphereN = 80;
+int meshM = 0, meshN = 0;
+
+#define MINSPHEREM 4
+#define MAXSPHEREM 1024
+
+//per-instance offset (xyz) and scale (w)
+int NumInstances = 0;
+std::vector<vec4> offsets;
+
+#define BUMPSIZE 512
+#define BUMPSTRENGTH 4.0
 
 //sphere
 #pragma endregion
 
+#ifndef HEADLESS_ONLY
 //GLFW functions
 static void error_callback(int error, const char* description)
 {
@@ -119,52 +286,87 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
 
-//TODO get these arguements sorted out
-void genPoint(int i, int j, int m, int n){
-	vec3 p = vec3(sin(M_PI * (float(j) / m)) * cos(2 * M_PI * (float(i) / n)),
-				sin(M_PI * (float(j) / m)) * sin(2 * M_PI * (float(i) / n)),
-				cos(M_PI * (float(j) / m)));
-	vec3 nor = normalize(p);
-	points.push_back(vec4(p, 1.0));
-	normals.push_back(nor);
-	tex_coord.push_back(vec2(.5 + atan2(-nor.z, -nor.x) / (M_PI * 2),
-		.5 - asin(-nor.y) / M_PI));
+	//arrows move the light in x and y, page up and down in z
+	if (action == GLFW_PRESS || action == GLFW_REPEAT){
+		switch (key){
+		case GLFW_KEY_LEFT:			lightPos.x -= LIGHTSTEP; break;
+		case GLFW_KEY_RIGHT:		lightPos.x += LIGHTSTEP; break;
+		case GLFW_KEY_DOWN:			lightPos.y -= LIGHTSTEP; break;
+		case GLFW_KEY_UP:			lightPos.y += LIGHTSTEP; break;
+		case GLFW_KEY_PAGE_DOWN:	lightPos.z -= LIGHTSTEP; break;
+		case GLFW_KEY_PAGE_UP:		lightPos.z += LIGHTSTEP; break;
+		}
+	}
 
+	//+ and - double and halve the sphere resolution, the render thread regenerates it
+	if (action == GLFW_PRESS){
+		if ((key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) && sphereM < MAXSPHEREM){
+			sphereM *= 2;
+			sphereN *= 2;
+		}
+		if ((key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) && sphereM > MINSPHEREM){
+			sphereM /= 2;
+			sphereN /= 2;
+		}
+	}
 }
+#endif
 
-//Create a sphere from long. (m) and lang. (n) parameters
-void genSphere(int m, int n, int r)
-{
 
-	for (int i = 0; i < n; ++i){
-		for (int j = 1; j <= m; ++j){
+//set vertex k to p on the unit sphere, buildSphere fills in the texture coordinates
+void genPoint(int k, const vec3& p){
+	vec3 nor = normalize(p);
+	points[k] = vec4(p, 1.0);
+	normals[k] = nor;
+
+	//tangent follows increasing u of the texture mapping, fall back at the poles
+	vec3 tangent = vec3(-nor.z, 0.0, nor.x);
+	tangents[k] = length(tangent) > DivideByZeroTolerance ? normalize(tangent) : vec3(1.0, 0.0, 0.0);
 
-			genPoint(i + 1, j, m, n);
+}
 
-			genPoint(i, j, m, n);
+//the color texture, decoded by a job while init compiles the shaders
+struct DecodedImage{
+	const char*		path;
+	unsigned char*	data;
+	int				width, height, channels;
+};
 
-			genPoint(i, j - 1, m, n);
+DecodedImage colorImage = { "BeachBallColor.jpg", NULL, 0, 0, 0 };
+JobCounter textureDecoded;
 
-			genPoint(i + 1, j - 1, m, n);
+static void decodeImage(void* data)
+{
+	DecodedImage* image = (DecodedImage*)data;
+	image->data = SOIL_load_image(image->path, &image->width, &image->height, &image->channels, SOIL_LOAD_AUTO);
+}
 
-			genPoint(i + 1, j, m, n);
+//start decoding the textures, loadTextures waits for them
+void decodeTextures()
+{
+	runJob(decodeImage, &colorImage, &textureDecoded, "decodeTexture");
+}
 
-			genPoint(i, j - 1, m, n);
-		}
-	}
+//upload the color texture and generate the bump map
+void loadTextures()
+{
 	//create texture data
 	//this is the default color texture
 	glActiveTexture(GL_TEXTURE0);
 
-	GLuint tex_ld = SOIL_load_OGL_texture
-		("BeachBallColor.jpg",
-		SOIL_LOAD_AUTO,
-		SOIL_CREATE_NEW_ID,
-		SOIL_FLAG_NTSC_SAFE_RGB
-		);
+	waitJobs(&textureDecoded);
+	GLuint tex_ld = 0;
+	if (colorImage.data){
+		tex_ld = SOIL_create_OGL_texture
+			(colorImage.data,
+			colorImage.width, colorImage.height, colorImage.channels,
+			SOIL_CREATE_NEW_ID,
+			SOIL_FLAG_NTSC_SAFE_RGB
+			);
+		SOIL_free_image_data(colorImage.data);
+		colorImage.data = NULL;
+	}
 
 	if (0 == tex_ld)
 	{
@@ -179,48 +381,510 @@ void genSphere(int m, int n, int r)
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
+	//the bump map is generated rather than loaded
+	if (bumpMapped)
+		genBumpTexture(GL_TEXTURE1, BUMPSIZE, BUMPSTRENGTH);
+
+	glUniform1i(glGetUniformLocation(program, "textureColor"), 0);
+	glUniform1i(glGetUniformLocation(program, "textureBump"), 1);
+
+	//a unit of its own even when unused, samplers of different types may not share one
+	glUniform1i(glGetUniformLocation(program, "ShadowMap"), SHADOWUNIT);
+}
+
+//attach the per-instance offsets to a vao drawn with prog
+void bindInstances(GLuint vao, GLuint prog)
+{
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	GLuint vOffset = glGetAttribLocation(prog, "vOffset");
+	glEnableVertexAttribArray(vOffset);
+	glVertexAttribPointer(vOffset, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribDivisor(vOffset, 1);
+
+	glBindVertexArray(0);
+}
+
+//lay count spheres out in a cube lattice that fits the view, xyz is the offset and w the scale
+void layoutInstances(int count)
+{
+	offsets.clear();
+
+	int side = 1;
+	while (side * side * side < count)
+		++side;
+
+	float scale = 1.0f / side;
+	for (int k = 0; k < side && int(offsets.size()) < count; ++k){
+		for (int j = 0; j < side && int(offsets.size()) < count; ++j){
+			for (int i = 0; i < side && int(offsets.size()) < count; ++i){
+				//neighbours overlap slightly so there is something to depth test
+				offsets.push_back(vec4((2 * i - side + 1) * scale * 0.9f,
+									   (2 * j - side + 1) * scale * 0.9f,
+									   -(2 * k) * scale * 0.9f,
+									   scale));
+			}
+		}
+	}
+
+	NumInstances = offsets.size();
+}
+
+//lay out and upload the instance offsets
+void genInstances(int count)
+{
+	layoutInstances(count);
+
+	//sortInstances takes its scratch from the frame arena
+	reserveFrameArena(offsets.size() * (sizeof(std::pair<float, int>) + sizeof(vec4)));
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof(vec4), &offsets[0], GL_STATIC_DRAW);
+	++casterVersion;
+}
+
+//instances per piece of the depth pass
+#define DEPTHGRAIN 1024
+
+struct InstanceDepths{
+	vec4						zRow;
+	std::pair<float, int>*		order;
+};
+
+//eye space z of each center, nearer is larger
+static void instanceDepths(int begin, int end, void* data)
+{
+	InstanceDepths& d = *(InstanceDepths*)data;
+	for (int i = begin; i < end; ++i)
+		d.order[i] = std::make_pair(-dot(d.zRow, vec4(offsets[i].x, offsets[i].y, offsets[i].z, 1.0)), i);
+}
+
+//order the instances nearest first so early depth testing rejects the hidden fragments
+void sortInstances(const mat4& modelView)
+{
+	int count = offsets.size();
+	if (count == 0)
+		return;
+
+	//scratch from the frame arena, this runs every frame
+	std::pair<float, int>* order = arenaArray<std::pair<float, int> >(frameArena, count);
+	InstanceDepths depths = { modelView[2], order };
+	parallelFor(0, count, DEPTHGRAIN, instanceDepths, &depths, "instanceDepths");
+
+	bool sorted = true;
+	for (int i = 1; i < count && sorted; ++i)
+		sorted = order[i - 1].first <= order[i].first;
+
+	//the camera moves slowly, most frames keep the last order
+	if (sorted)
+		return;
+
+	std::sort(order, order + count);
+
+	vec4* sortedOffsets = arenaArray<vec4>(frameArena, count);
+	for (int i = 0; i < count; ++i)
+		sortedOffsets[i] = offsets[order[i].second];
+	std::copy(sortedOffsets, sortedOffsets + count, offsets.begin());
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(vec4), &offsets[0]);
+}
+
+//grid columns per parallelFor piece, and vertices per texture coordinate batch
+#define SPHEREGRAIN 8
+#define TEXCOORDBLOCK 1024
+
+//the sphere grid, shared by the jobs that fill it in
+struct SphereGrid{
+	int		m, n;
+	float*	sinLat;
+	float*	cosLat;
+	float*	sinLong;
+	float*	cosLong;
+};
+
+//one vertex per grid point, longitude n is longitude 0 again
+static void spherePoints(int begin, int end, void* data)
+{
+	SphereGrid& g = *(SphereGrid*)data;
+	for (int i = begin; i < end; ++i){
+		for (int j = 0; j <= g.m; ++j)
+			genPoint(i * (g.m + 1) + j, vec3(g.sinLat[j] * g.cosLong[i], g.sinLat[j] * g.sinLong[i], g.cosLat[j]));
+	}
+}
+
+//u = .5 + atan2(-z, -x) / 2pi, v = .5 - asin(-y) / pi, a batch for each block of vertices
+//blocks are a multiple of 4 long, so the same vertices take the SIMD path as in one batch
+static void sphereTexCoords(int begin, int end, void* data)
+{
+	int count = *(int*)data;
+	float negX[TEXCOORDBLOCK], negY[TEXCOORDBLOCK], negZ[TEXCOORDBLOCK], u[TEXCOORDBLOCK], v[TEXCOORDBLOCK];
+	for (int block = begin; block < end; ++block){
+		int first = block * TEXCOORDBLOCK;
+		int size = std::min(count - first, TEXCOORDBLOCK);
+		for (int k = 0; k < size; ++k){
+			negX[k] = -normals[first + k].x;
+			negY[k] = -normals[first + k].y;
+			negZ[k] = -normals[first + k].z;
+		}
+		atan2Batch(negZ, negX, u, size);
+		asinBatch(negY, v, size);
+		for (int k = 0; k < size; ++k)
+			tex_coord[first + k] = vec2(.5 + u[k] / (M_PI * 2), .5 - v[k] / M_PI);
+	}
+}
+
+static void sphereIndices(int begin, int end, void* data)
+{
+	SphereGrid& g = *(SphereGrid*)data;
+	for (int i = begin; i < end; ++i){
+		GLuint column = i * (g.m + 1);
+		GLuint next = ((i + 1) % g.n) * (g.m + 1);
+		GLuint* out = &indices[i * g.m * 6];
+
+		for (int j = 1; j <= g.m; ++j){
+
+			*out++ = next + j;
+
+			*out++ = column + j;
+
+			*out++ = column + j - 1;
+
+			*out++ = next + j - 1;
+
+			*out++ = next + j;
+
+			*out++ = column + j - 1;
+		}
+	}
+}
+
+//one attribute array of the sphere and the order to put it in
+template <class T>
+struct RemapJob{
+	std::vector<T>*				vertices;
+	const std::vector<GLuint>*	remap;
+};
+
+template <class T>
+static void remapJob(void* data)
+{
+	RemapJob<T>* job = (RemapJob<T>*)data;
+	remapVertices(*job->vertices, *job->remap);
+}
+
+//Create the sphere vertices from long. (m) and lang. (n) parameters, CPU side only
+void buildSphere(int m, int n)
+{
+	PROFILE_SCOPE("buildSphere");
+
+	int count = n * (m + 1);
+	points.resize(count);
+	normals.resize(count);
+	tex_coord.resize(count);
+	tangents.resize(count);
+
+	indices.resize(n * m * 6);
+
+	//the angles step regularly, so their sines and cosines come from a recurrence
+	std::vector<float> sinLat(m + 1), cosLat(m + 1), sinLong(n), cosLong(n);
+	sincosSteps(0.0, M_PI / m, m + 1, &sinLat[0], &cosLat[0]);
+	sincosSteps(0.0, 2 * M_PI / n, n, &sinLong[0], &cosLong[0]);
+
+	//every vertex and index has its own slot, so the pieces fill them in any order
+	SphereGrid grid = { m, n, &sinLat[0], &cosLat[0], &sinLong[0], &cosLong[0] };
+	parallelFor(0, n, SPHEREGRAIN, spherePoints, &grid, "spherePoints");
+	parallelFor(0, (count + TEXCOORDBLOCK - 1) / TEXCOORDBLOCK, 1, sphereTexCoords, &count, "sphereTexCoords");
+	parallelFor(0, n, SPHEREGRAIN, sphereIndices, &grid, "sphereIndices");
+
+	NumVertices = points.size();
+	NumIndices = indices.size();
+
+	if (meshOptimize){
+		CacheStats before = analyzeVertexCache(indices, NumVertices);
+
+		optimizeVertexCache(indices, NumVertices);
+
+		std::vector<GLuint> remap;
+		optimizeVertexFetch(indices, NumVertices, remap);
+
+		//the four attribute arrays are independent
+		RemapJob<vec4> remapPoints = { &points, &remap };
+		RemapJob<vec3> remapNormals = { &normals, &remap };
+		RemapJob<vec2> remapTex = { &tex_coord, &remap };
+		RemapJob<vec3> remapTangents = { &tangents, &remap };
+		JobCounter remapped;
+		runJob(remapJob<vec4>, &remapPoints, &remapped, "remapVertices");
+		runJob(remapJob<vec3>, &remapNormals, &remapped, "remapVertices");
+		runJob(remapJob<vec2>, &remapTex, &remapped, "remapVertices");
+		runJob(remapJob<vec3>, &remapTangents, &remapped, "remapVertices");
+		waitJobs(&remapped);
+
+		CacheStats after = analyzeVertexCache(indices, NumVertices);
+		printf("Sphere %dx%d: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", m, n,
+			   before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+}
+
+//Create a sphere from long. (m) and lang. (n) parameters and upload it
+void genSphere(int m, int n, int r)
+{
+	if (gpuMesh){
+		NumVertices = sphereVertexCount(m, n);
+		NumIndices = sphereIndexCount(m, n);
+	}
+	else
+		buildSphere(m, n);
+	meshM = m;
+	meshN = n;
+
+	//regenerating replaces the previous mesh
+	if (sphereVao){
+		glDeleteVertexArrays(1, &sphereVao);
+		glDeleteBuffers(1, &sphereBuffer);
+		glDeleteBuffers(1, &sphereIndexBuffer);
+	}
+	if (depthVao)
+		glDeleteVertexArrays(1, &depthVao);
+	if (shadowVao)
+		glDeleteVertexArrays(1, &shadowVao);
+	++casterVersion;
+
 	glGenVertexArrays(1, &sphereVao);
 	glBindVertexArray(sphereVao);
 
 
 	//get arrays from vector data structures
+	//with -halfverts every attribute is a half float and each array starts 4 byte aligned,
+	//normals and tangents are padded to four halves (w unused) so every vertex stays 8 byte aligned
+
+	GLenum vertexType = halfVertices ? GL_HALF_FLOAT : GL_FLOAT;
+	int scalarSize = halfVertices ? sizeof(half) : sizeof(GLfloat);
+	int sizeof_points = (NumVertices * 4 * scalarSize + 3) & ~3;
+	int directionSize = halfVertices ? 4 : 3;
+	int sizeof_normals = (NumVertices * directionSize * scalarSize + 3) & ~3;
+	int sizeof_tex = (NumVertices * 2 * scalarSize + 3) & ~3;
+	int sizeof_tangents = (NumVertices * directionSize * scalarSize + 3) & ~3;
+
+	glGenBuffers(1, &sphereBuffer);
+	glGenBuffers(1, &sphereIndexBuffer);
+
+	if (gpuMesh){
+		computeSphere(m, n, sphereBuffer, sphereIndexBuffer);
+		glUseProgram(program);
+	}
+	else{
+		const void* pointData = &points[0];
+		const void* normalData = &normals[0];
+		const void* texData = &tex_coord[0];
+		const void* tangentData = &tangents[0];
+
+		std::vector<hvec4> halfPoints, halfNormals, halfTangents;
+		std::vector<hvec2> halfTex;
+		if (halfVertices){
+			halfPoints.resize(NumVertices);
+			halfNormals.resize(NumVertices);
+			halfTex.resize(NumVertices);
+			halfTangents.resize(NumVertices);
+			toHalves(&points[0], &halfPoints[0], NumVertices);
+			toHalves(&tex_coord[0], &halfTex[0], NumVertices);
+			for (int i = 0; i < NumVertices; ++i){
+				halfNormals[i] = hvec4(hvec3(normals[i]), half(0.0f));
+				halfTangents[i] = hvec4(hvec3(tangents[i]), half(0.0f));
+			}
+			pointData = &halfPoints[0];
+			normalData = &halfNormals[0];
+			texData = &halfTex[0];
+			tangentData = &halfTangents[0];
+		}
 
-	NumVertices = points.size();
+		glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof_points+sizeof_normals+sizeof_tex+sizeof_tangents, NULL, GL_STATIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, NumVertices * 4 * scalarSize, pointData);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof_points, NumVertices * directionSize * scalarSize, normalData);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof_points+sizeof_normals, NumVertices * 2 * scalarSize, texData);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof_points+sizeof_normals+sizeof_tex, NumVertices * directionSize * scalarSize, tangentData);
 
-	int sizeof_points = points.size() * sizeof(vec4);
-	int sizeof_normals = normals.size() * sizeof(vec3);
-	int sizeof_tex = tex_coord.size() * sizeof(vec2);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	}
 
-	GLuint buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof_points+sizeof_normals+sizeof_tex, NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof_points, &points[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, sizeof_points, sizeof_normals, &normals[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, sizeof_points+sizeof_normals, sizeof_tex, &tex_coord[0]);
+	//the element buffer binding is part of the vao
+	glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
 
 	GLuint vPosition = glGetAttribLocation(program, "vPosition");
 	glEnableVertexAttribArray(vPosition);
-	glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(vPosition, 4, vertexType, GL_FALSE, 0, 0);
+
+	//only the bump mapped shaders read tangents
+	GLint vTangent = glGetAttribLocation(program, "vTangent");
+	if (vTangent >= 0){
+		glEnableVertexAttribArray(vTangent);
+		glVertexAttribPointer(vTangent, directionSize, vertexType, GL_FALSE, 0, BUFFER_OFFSET(sizeof_points+sizeof_normals+sizeof_tex));
+	}
 
 	GLuint vNormal = glGetAttribLocation(program, "vNormal");
 	glEnableVertexAttribArray(vNormal);
-	glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof_points));
+	glVertexAttribPointer(vNormal, directionSize, vertexType, GL_FALSE, 0, BUFFER_OFFSET(sizeof_points));
 
 	GLuint vTexCoord = glGetAttribLocation(program, "vTexCoord");
 	glEnableVertexAttribArray(vTexCoord);
-	glVertexAttribPointer(vTexCoord, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof_points+sizeof_normals));
+	glVertexAttribPointer(vTexCoord, 2, vertexType, GL_FALSE, 0, BUFFER_OFFSET(sizeof_points+sizeof_normals));
 
-	glUniform1i(glGetUniformLocation(program, "textureColor"), 0);
+	glBindVertexArray(0);
 
+	bindInstances(sphereVao, program);
+
+	//the pre-pass reads only the positions, which lead the buffer tightly packed
+	if (depthProgram){
+		glGenVertexArrays(1, &depthVao);
+		glBindVertexArray(depthVao);
+		glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+
+		GLuint vDepthPosition = glGetAttribLocation(depthProgram, "vPosition");
+		glEnableVertexAttribArray(vDepthPosition);
+		glVertexAttribPointer(vDepthPosition, 4, vertexType, GL_FALSE, 0, 0);
+
+		glBindVertexArray(0);
+
+		bindInstances(depthVao, depthProgram);
+	}
+
+	//same for the shadow casters
+	if (shadowProgram){
+		glGenVertexArrays(1, &shadowVao);
+		glBindVertexArray(shadowVao);
+		glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+
+		GLuint vShadowPosition = glGetAttribLocation(shadowProgram, "vPosition");
+		glEnableVertexAttribArray(vShadowPosition);
+		glVertexAttribPointer(vShadowPosition, 4, vertexType, GL_FALSE, 0, 0);
+
+		glBindVertexArray(0);
+
+		bindInstances(shadowVao, shadowProgram);
+	}
+}
+
+
+//octahedron the tessellation shaders refine, 8 patches of 3 corners
+#define OCTAHEDRONINDICES 24
+
+void genOctahedron()
+{
+	static const GLfloat corners[6][4] = {
+		{ 1, 0, 0, 1 }, { -1, 0, 0, 1 },
+		{ 0, 1, 0, 1 }, { 0, -1, 0, 1 },
+		{ 0, 0, 1, 1 }, { 0, 0, -1, 1 }
+	};
+	//counter clockwise seen from outside
+	static const GLuint faces[OCTAHEDRONINDICES] = {
+		0, 2, 4,	2, 1, 4,	1, 3, 4,	3, 0, 4,
+		2, 0, 5,	1, 2, 5,	3, 1, 5,	0, 3, 5
+	};
+
+	glGenVertexArrays(1, &tessVao);
+	glBindVertexArray(tessVao);
+
+	glGenBuffers(1, &sphereBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, sphereBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &sphereIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+
+	GLuint vPosition = glGetAttribLocation(program, "vPosition");
+	glEnableVertexAttribArray(vPosition);
+	glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glBindVertexArray(0);
+
+	bindInstances(tessVao, program);
+	glPatchParameteri(GL_PATCH_VERTICES, 3);
 }
 
 
 // OpenGL initialization
 void init()
 {
+	//the jpeg decodes on a worker while the shaders compile
+	decodeTextures();
+
+	if (impostors && (deferredLights || clusteredLights)){
+		printf("Impostors are only drawn by the forward path, ignoring -impostors\n");
+		impostors = false;
+	}
+	if (impostors && (bumpMapped || prepass || shadows)){
+		printf("Impostors are drawn without -bump, -prepass and -shadows\n");
+		bumpMapped = prepass = shadows = false;
+	}
+	if (tessEdge > 0 && (impostors || deferredLights || clusteredLights)){
+		printf("Tessellation is only drawn by the forward mesh path, ignoring -tessellate\n");
+		tessEdge = 0;
+	}
+	//there is no fixed mesh to draw into the depth or shadow maps
+	if (tessEdge > 0 && (bumpMapped || prepass || shadows)){
+		printf("Tessellated spheres are drawn without -bump, -prepass and -shadows\n");
+		bumpMapped = prepass = shadows = false;
+	}
+
 	// Load shaders and use the resulting shader program
-	program = InitShader("vshaderTexture.glsl", "fshaderTexture.glsl");
+	if (impostors)
+		program = InitShader("vshaderImpostor.glsl", "fshaderImpostor.glsl");
+	else if (tessEdge > 0){
+		if (!hasGLVersion(4, 3)){
+			printf("Tessellation shaders need OpenGL 4.3\n");
+			exit(EXIT_FAILURE);
+		}
+		//the evaluation shader feeds the plain texture fragment shader
+		program = InitShader("vshaderTess.glsl", "fshaderTexture.glsl", NULL, "tcshaderTess.glsl", "teshaderTess.glsl");
+	}
+	else if (deferredLights){
+		if (!hasGLVersion(4, 3)){
+			printf("The deferred path needs OpenGL 4.3 for compute shaders\n");
+			exit(EXIT_FAILURE);
+		}
+		if (bumpMapped || prepass)
+			printf("The deferred path draws the texture shaders without a pre-pass, ignoring -bump and -prepass\n");
+		bumpMapped = prepass = false;
+		program = InitShader("vshaderGBuffer.glsl", "fshaderGBuffer.glsl");
+	}
+	else if (clusteredLights){
+		if (!hasGLVersion(4, 3)){
+			printf("The clustered path needs OpenGL 4.3 for compute shaders\n");
+			exit(EXIT_FAILURE);
+		}
+		//one shader does both, the bump map is applied in eye space
+		program = InitShader("vshaderClustered.glsl", "fshaderClustered.glsl");
+	}
+	else if (bumpMapped)
+		program = InitShader("vshaderFinalTexture.glsl", "fshaderFinalTexture.glsl");
+	else
+		program = InitShader("vshaderTexture.glsl", "fshaderTexture.glsl");
+
+	if (shadows && (deferredLights || clusteredLights)){
+		printf("Shadows are only drawn by the forward shaders, ignoring -shadows\n");
+		shadows = false;
+	}
+	if (shadows){
+		if (!hasGLVersion(3, 2)){
+			printf("Shadows need OpenGL 3.2 for layered rendering\n");
+			exit(EXIT_FAILURE);
+		}
+		shadowProgram = initShadows(SHADOWSIZE, SHADOWFAR);
+	}
+
+	if (prepass){
+		depthProgram = InitShader("vshaderDepth.glsl", "fshaderDepth.glsl");
+		DepthModelView = glGetUniformLocation(depthProgram, "ModelView");
+		DepthProjection = glGetUniformLocation(depthProgram, "Projection");
+		DepthRot = glGetUniformLocation(depthProgram, "Rot");
+	}
 
 	glUseProgram(program);
 
@@ -232,6 +896,8 @@ void init()
 	LightPosition = glGetUniformLocation(program, "LightPosition");
 	Shininess = glGetUniformLocation(program, "Shininess");
 	Rot = glGetUniformLocation(program, "Rot");
+	ViewSize = glGetUniformLocation(program, "ViewSize");
+	glUniform1f(glGetUniformLocation(program, "TessEdge"), tessEdge);
 
 
 	//Setup the view volume with Perspective
@@ -243,23 +909,85 @@ void init()
 	//calculate matrices
 	mv = LookAt(eye, at, up);
 
-	rot = vec4(1, 0, 0, 0);
+	rot = prevRot = drawRot = vec4(1, 0, 0, 0);
+	initTimestep(simClock, SIMDT);
 
 
 	glUniform4fv(LightPosition, 1, lightPos);
+	drawLight = lightPos;
 	glUniformMatrix4fv(ModelView, 1, GL_TRUE, mv);
 	glUniformMatrix4fv(Projection, 1, GL_TRUE, proj);
 	glUniform4fv(AmbientProduct, 1, LIGHTAMB);
 	glUniform4fv(DiffuseProduct, 1, LIGHTDIF);
 	glUniform4fv(SpecularProduct, 1, LIGHTSPE);
-	glUniform1f(Shininess, 30000);
-
-	genSphere(40, 80, 1);
+	glUniform1f(Shininess, LIGHTSHI);
+	glUniform1i(glGetUniformLocation(program, "BumpMapped"), bumpMapped);
+	glUniform1i(glGetUniformLocation(program, "Shadowed"), shadows);
+	glUniform1f(glGetUniformLocation(program, "ShadowFar"), SHADOWFAR);
+	if (shadows)
+		bindShadowMap(GL_TEXTURE0 + SHADOWUNIT);
+
+	loadTextures();
+
+	glGenBuffers(1, &instanceBuffer);
+	genInstances(startInstances);
+
+	//impostors read only the instances, their corners come from gl_VertexID
+	if (impostors){
+		glGenVertexArrays(1, &impostorVao);
+		bindInstances(impostorVao, program);
+	}
+	else if (tessEdge > 0)
+		genOctahedron();
+	else{
+		if (gpuMesh){
+			if (!hasGLVersion(4, 3)){
+				printf("-gpumesh needs OpenGL 4.3 for compute shaders\n");
+				exit(EXIT_FAILURE);
+			}
+			initSphereCompute();
+			if (halfVertices){
+				printf("The compute shader writes floats, ignoring -halfverts\n");
+				halfVertices = false;
+			}
+		}
+		genSphere(sphereM, sphereN, 1);
+	}
 
 	glEnable(GL_DEPTH_TEST);
 	glShadeModel(GL_FLAT);
 
-	glClearColor(1.0, 1.0, 1.0, 1.0);
+	glClearColor(BACKGROUND.x, BACKGROUND.y, BACKGROUND.z, BACKGROUND.w);
+
+	if (deferredLights || clusteredLights){
+		genLights(deferredLights ? deferredLights : clusteredLights, lightPos, lights);
+		lightBuffer = createLightBuffer(lights);
+	}
+	if (deferredLights)
+		initDeferred(screenWidth, screenHeight, LIGHTAMB, LIGHTSPE, LIGHTSHI, BACKGROUND);
+	if (clusteredLights)
+		initClustered(program, zpNear, zpFar);
+	glUseProgram(program);
+}
+
+//geometry and light pass of the deferred path
+void displayDeferred(const mat4& modelView, const mat4& projection)
+{
+	profileGpuBegin("gbuffer");
+	deferredGeometryPass();
+
+	glBindVertexArray(sphereVao);
+
+	overdrawBegin();
+	glDrawElementsInstanced(GL_TRIANGLES, NumIndices, GL_UNSIGNED_INT, 0, NumInstances);
+	overdrawEnd(viewWidth * viewHeight);
+
+	glBindVertexArray(0);
+	profileGpuEnd();
+
+	profileGpuBegin("lighting");
+	deferredLightPass(modelView, projection, lightBuffer, lights.size());
+	profileGpuEnd();
 }
 
 //Display function
@@ -267,16 +995,77 @@ void display()
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	if (depthProgram){
+		//depth only, nothing is shaded
+		glUseProgram(depthProgram);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glBindVertexArray(depthVao);
+		glDrawElementsInstanced(GL_TRIANGLES, NumIndices, GL_UNSIGNED_INT, 0, NumInstances);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		//depth is final, only the visible fragment of each pixel gets shaded
+		glUseProgram(program);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
 
-	glBindVertexArray(sphereVao);
-	glUniform4fv(Rot, 1, rot);
-
-	glDrawArrays(GL_TRIANGLES, 0 , NumVertices);
+	overdrawBegin();
+	if (impostors){
+		glBindVertexArray(impostorVao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, NumInstances);
+	}
+	else if (tessEdge > 0){
+		glBindVertexArray(tessVao);
+		glDrawElementsInstanced(GL_PATCHES, OCTAHEDRONINDICES, GL_UNSIGNED_INT, 0, NumInstances);
+	}
+	else{
+		glBindVertexArray(sphereVao);
+		glDrawElementsInstanced(GL_TRIANGLES, NumIndices, GL_UNSIGNED_INT, 0, NumInstances);
+	}
+	overdrawEnd(viewWidth * viewHeight);
 
 	glBindVertexArray(0);
-	
+
+	//glClear honors the depth mask, restore it for the next frame
+	if (depthProgram){
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+}
+
+void rotate(double x0, double y0, double x1, double y1, double speed){
+	rot = q_multiply(trackballRotation(x0, y0, x1, y1, speed, screenWidth, screenHeight), rot);
+}
+
+//apply every cursor movement since the last call as a single rotation, true if there was any
+bool applyDrag(){
+	if (!dragPending)
+		return false;
+
+	rotate(dragX, dragY, xCur, yCur, 1.0);
+	//dragging is applied at once, only the simulation is interpolated
+	prevRot = rot;
+	dragX = xCur;
+	dragY = yCur;
+	dragPending = false;
+	return true;
+}
+
+//GLFW mouseMotion function
+//only records the cursor, the last event delta is kept for the momentum spin
+void mouseMotion(GLFWwindow* window, double xPos, double yPos)
+{
+	if(buttonHeld) {
+		xPrev = xCur;
+		yPrev = yCur;
+		xCur = xPos;
+		yCur = yPos;
+		dragPending = true;
+	}
 }
 
+#ifndef HEADLESS_ONLY
 //GLFW mouse function
 void mouseButton( GLFWwindow *window, int button, int action, int mods)
 {
@@ -284,131 +1073,699 @@ void mouseButton( GLFWwindow *window, int button, int action, int mods)
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS){
 		buttonHeld = true;
 		velocity = false;
+		dragX = xCur;
+		dragY = yCur;
 	}
 	else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE){
+		//finish the drag before momentum takes over
+		applyDrag();
 		buttonHeld = false;
 		velocity = true;
 	}
 }
+#endif
+
+//GLFW resize func
+//may run on a thread without the GL context, the viewport follows in drawFrame
+void windowFunc(GLFWwindow*, int w, int h){
+	float ar = (float)(w) / h;
+	screenHeight = h;
+	screenWidth = w;
+
+
+	proj = Perspective(fovy, ar, zpNear, zpFar);
+
+
+}
 
-vec4 q_multiply(vec4 a, vec4 b){
+//one fixed step of the simulation
+void simulate()
+{
+	prevRot = rot;
+	if (velocity){
+		rotate(xPrev, yPrev, xCur, yCur, SPINRATE * SIMDT);
+	}
+}
 
-	float vDot = dot(vec3(a.y, a.z, a.w), vec3(b.y, b.z, b.w));
-	vec3 vCross = cross(vec3(a.y, a.z, a.w), vec3(b.y, b.z, b.w));
-	vec3 v1 = a.x * vec3(b.y, b.z, b.w);
-	vec3 v2 = b.x * vec3(a.y, a.z, a.w);
-	return vec4(a.x * b.x - vDot, vCross.x + v1.x + v2.x,
-							      vCross.y + v1.y + v2.y, 
-								  vCross.z + v1.z + v2.z );
+//advance the simulation by frameSeconds and take what the next frame draws
+void simulateFrame(double frameSeconds, FrameSnapshot& snapshot)
+{
+	PROFILE_SCOPE("simulate");
+
+	applyDrag();
+
+	int steps = advanceTimestep(simClock, frameSeconds);
+	for (int i = 0; i < steps; ++i)
+		simulate();
+	drawRot = q_nlerp(prevRot, rot, timestepAlpha(simClock));
+
+	snapshot.rot = drawRot;
+	snapshot.light = lightPos;
+	snapshot.meshM = sphereM;
+	snapshot.meshN = sphereN;
+	snapshot.modelView = mv;
+	snapshot.projection = proj;
+	snapshot.width = screenWidth;
+	snapshot.height = screenHeight;
+	snapshot.latch = latchSequence();
 }
 
+//draw and capture one frame from a snapshot, only touches GL state
+void drawFrame(const FrameSnapshot& snapshot)
+{
+	//the impostor and tessellation paths have no sphere mesh
+	if (sphereVao && (snapshot.meshM != meshM || snapshot.meshN != meshN)){
+		PROFILE_SCOPE("regenerate");
+		profileGpuBegin("regenerate");
+		genSphere(snapshot.meshM, snapshot.meshN, 1);
+		profileGpuEnd();
+		printf("Sphere regenerated at %dx%d\n", meshM, meshN);
+	}
+
+	if (snapshot.width != viewWidth || snapshot.height != viewHeight){
+		glViewport(0, 0, snapshot.width, snapshot.height);
+		viewWidth = snapshot.width;
+		viewHeight = snapshot.height;
+
+		if (deferredLights)
+			resizeDeferred(viewWidth, viewHeight);
+		if (tessEdge > 0)
+			glUniform2f(ViewSize, viewWidth, viewHeight);
+	}
+
+	glUniformMatrix4fv(Projection, 1, GL_TRUE, snapshot.projection);
+	glUniformMatrix4fv(ModelView, 1, GL_TRUE, snapshot.modelView);
+	glUniform4fv(Rot, 1, snapshot.rot);
+
+	if (depthProgram){
+		glUseProgram(depthProgram);
+		glUniformMatrix4fv(DepthProjection, 1, GL_TRUE, snapshot.projection);
+		glUniformMatrix4fv(DepthModelView, 1, GL_TRUE, snapshot.modelView);
+		glUniform4fv(DepthRot, 1, snapshot.rot);
+		glUseProgram(program);
+	}
+
+	if (frontToBack)
+		sortInstances(snapshot.modelView);
+
+	point4 light = snapshot.light;
+	if (!(light == drawLight)){
+		drawLight = light;
+		glUniform4fv(LightPosition, 1, drawLight);
+
+		//light 0 of the many-light paths is the same light
+		if (lightBuffer){
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 3 * sizeof(GLfloat), drawLight);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+	}
 
-vec3 hemisphereMap(double x, double y){
-	double xAdj = (2 * x - screenWidth) / screenWidth;
-	double yAdj = (screenHeight - 2 * y) / screenHeight;
-	float len = sqrt(xAdj*xAdj + yAdj*yAdj);
-	len = (len < 1.0) ? len : 1.0;
-	return normalize(vec3(xAdj, yAdj, sqrt(1.001 - len * len)));
+	//the cached map is reused until the light or a caster moves
+	if (shadowProgram && shadowsStale(snapshot.light, snapshot.rot, casterVersion)){
+		PROFILE_SCOPE("shadows");
+		profileGpuBegin("shadows");
+		beginShadowPass(snapshot.light, snapshot.rot, casterVersion);
+		glBindVertexArray(shadowVao);
+		glDrawElementsInstanced(GL_TRIANGLES, NumIndices, GL_UNSIGNED_INT, 0, NumInstances);
+		glBindVertexArray(0);
+		endShadowPass();
+		profileGpuEnd();
+	}
 
+	//light assignment counts as display, as the light pass of the deferred path does
+	{
+		PROFILE_SCOPE("display");
+		profileGpuBegin("display");
+		if (clusteredLights){
+			PROFILE_SCOPE("clusters");
+			profileGpuBegin("clusters");
+			clusterLights(snapshot.modelView, snapshot.projection, lightBuffer, lights.size(), viewWidth, viewHeight);
+			profileGpuEnd();
+		}
+		if (deferredLights)
+			displayDeferred(snapshot.modelView, snapshot.projection);
+		else
+			display();
+		profileGpuEnd();
+	}
 
+	//read the back buffer before it is swapped away
+	if (capturePrefix){
+		PROFILE_SCOPE("capture");
+		profileGpuBegin("capture");
+		if (headlessFrames > 0)
+			resolveHeadlessTarget();
+		captureFrame(snapshot.width, snapshot.height);
+		profileGpuEnd();
+	}
 }
 
-void rotate(double x0, double y0, double x1, double y1, double speed){
-	vec3 init = hemisphereMap(x0, y0);
-	vec3 fin = hemisphereMap(x1, y1);
+//simulate and draw one frame on this thread, shared by the window and headless loops
+void renderFrame(double frameSeconds)
+{
+	FrameSnapshot snapshot;
+	simulateFrame(frameSeconds, snapshot);
+	drawFrame(snapshot);
+}
+
+#ifndef HEADLESS_ONLY
+GLFWwindow* renderWindow = NULL;
+
+//body of the render thread, draws each snapshot the main thread publishes
+void renderLoop()
+{
+	glfwMakeContextCurrent(renderWindow);
+	glfwSwapInterval(swapInterval);
+
+	FrameSnapshot snapshot;
+	while (takeSnapshot(snapshot)){
+
+		allocFrameBegin();
+		profileFrameBegin();
+
+		//a drag that came in after the snapshot was taken still makes this frame
+		latchedRotation(snapshot.latch, snapshot.rot);
+
+		drawFrame(snapshot);
+
+		{
+			PROFILE_SCOPE("swap");
+			glfwSwapBuffers(renderWindow);
+		}
+
+		profileFrameEnd();
+		allocFrameEnd();
 
-	vec3 n = cross(init, fin);
+		//the main thread sees the failure and stops the simulation
+		if (allocCheckFailed())
+			break;
+	}
 
-	vec3 axis = normalize(n);
-	float mag = speed * length(n);
+	//the GL resources have to be released on the thread that owns the context
+	if (capturePrefix)
+		finishCapture();
 
+	shutdownOverdraw();
+	shutdownDeferred();
+	shutdownClustered();
+	shutdownSphereCompute();
+	shutdownShadows();
+	shutdownProfiler();
 
-	float s = sin(mag / 2);
-	vec4 nRot = vec4(cos(mag / 2), axis.x * s, axis.y * s, axis.z * s);
-	rot = q_multiply(nRot, rot);
+	glfwMakeContextCurrent(NULL);
 }
 
-//GLFW mouseMotion function
-void mouseMotion(GLFWwindow* window, double xPos, double yPos)
+//main thread of -threaded, input and simulation while the render thread draws
+void runThreaded(GLFWwindow* window)
 {
-	if(buttonHeld) {
-		xPrev = xCur;
-		yPrev = yCur;
-		rotate(xPrev, yPrev, xPos, yPos, 1.0);
-		xCur = xPos;
-		yCur = yPos;
+	FrameLimiter limiter;
+	initFrameLimiter(limiter, frameCap);
+	double lastTime = timestepNow();
+
+	renderWindow = window;
+	glfwMakeContextCurrent(NULL);
+	startRenderThread(renderLoop);
+
+	while (!glfwWindowShouldClose(window) && !allocCheckFailed()){
+
+		//the renderer is still on the last frame, keep handling input meanwhile
+		//and hand each drag straight to the latch
+		if (!waitSnapshotTaken(0.0005)){
+			glfwPollEvents();
+			if (applyDrag())
+				latchRotation(rot);
+			continue;
+		}
+
+		waitFrameLimiter(limiter);
+
+		{
+			PROFILE_SCOPE("poll");
+			glfwPollEvents();
+		}
+
+		double now = timestepNow();
+		simulateFrame(now - lastTime, snapshotBack());
+		lastTime = now;
+
+		publishSnapshot();
 	}
+
+	stopRenderThread();
 }
+#endif
 
-//GLFW resize func
-void windowFunc(GLFWwindow*, int w, int h){
-	glViewport(0, 0, w, h);
+//render a fixed number of frames offscreen
+void runHeadless()
+{
+	for (int frame = 0; frame < headlessFrames; ++frame){
 
-	float ar = (float)(w) / h;
-	screenHeight = h;
-	screenWidth = w;
+		allocFrameBegin();
+		profileFrameBegin();
+		renderFrame(BENCHDT);
+		profileFrameEnd();
+		allocFrameEnd();
 
+		if (allocCheckFailed())
+			break;
+	}
 
-	proj = Perspective(fovy, ar, zpNear, zpFar);
-	glUniformMatrix4fv(Projection, 1, GL_TRUE, proj);
+	//nothing is presented, make sure the last frame has actually been rendered
+	glFinish();
+}
+
+#pragma region software renderer
 
+//render the first frame of -headless on the CPU and write it to softPath
+void runSoftware()
+{
+	if (bumpMapped)
+		printf("The software renderer only draws the texture shaders, ignoring -bump\n");
 
+	SoftTexture texture;
+	if (!loadSoftTexture("BeachBallColor.jpg", texture))
+		exit(EXIT_FAILURE);
 
+	buildSphere(40, 80);
+	layoutInstances(startInstances);
+
+	SoftScene scene;
+	scene.points = &points[0];
+	scene.normals = &normals[0];
+	scene.texCoords = &tex_coord[0];
+	scene.vertexCount = NumVertices;
+	scene.indices = &indices[0];
+	scene.indexCount = NumIndices;
+	scene.offsets = &offsets[0];
+	scene.instanceCount = NumInstances;
+	scene.rot = vec4(1, 0, 0, 0);
+	scene.modelView = LookAt(eye, at, up);
+	scene.projection = Perspective(fovy, (float)(screenWidth) / screenHeight, zpNear, zpFar);
+	scene.lightPosition = lightPos;
+	scene.ambientProduct = LIGHTAMB;
+	scene.diffuseProduct = LIGHTDIF;
+	scene.specularProduct = LIGHTSPE;
+	scene.shininess = LIGHTSHI;
+	scene.clearColor = BACKGROUND;
+	scene.texture = &texture;
+
+	std::vector<unsigned char> rgba;
+
+	double start = timestepNow();
+	softRender(scene, screenWidth, screenHeight, rgba);
+	double ms = (timestepNow() - start) * 1000.0;
+
+	printf("Software rendered %d triangles at %dx%d in %.2f ms\n", NumIndices / 3 * NumInstances,
+		   screenWidth, screenHeight, ms);
+
+	if (!writeImage(softPath, captureType, &rgba[0], screenWidth, screenHeight))
+		exit(EXIT_FAILURE);
 }
 
-//GLFW idle function
-void idle()
+//software renderer
+#pragma endregion
+
+#pragma region benchmark
+
+GLFWwindow* benchWindow = NULL;
+
+long long benchSetup(int m, int n, int instances)
 {
-	if (velocity){
-		rotate(xPrev, yPrev, xCur, yCur, 0.01);
+	//the mesh size is moot when the GPU generates the triangles
+	if (!impostors && tessEdge <= 0){
+		sphereM = m;
+		sphereN = n;
+		genSphere(m, n, 1);
+	}
+	genInstances(instances);
+
+	//an impostor is one quad, the tessellator picks its own count from the view
+	if (impostors)
+		return 2LL * NumInstances;
+	if (tessEdge > 0)
+		return -1;
+	return (long long)(NumIndices / 3) * NumInstances;
+}
+
+bool benchFrame(int frame)
+{
+	benchPath(frame, rot, eye);
+	prevRot = rot;
+	mv = LookAt(eye, at, up);
+
+	allocFrameBegin();
+	profileFrameBegin();
+
+	renderFrame(BENCHDT);
+
+#ifndef HEADLESS_ONLY
+	if (benchWindow){
+		PROFILE_SCOPE("swap");
+		glfwSwapBuffers(benchWindow);
+		glfwPollEvents();
 	}
+#endif
+
+	profileFrameEnd();
+	allocFrameEnd();
+
+	//main shuts down and exits once the sweep stops
+	return !allocCheckFailed();
 }
 
+//benchmark
+#pragma endregion
+
 //main function
 int main( int argc, char **argv )
 {
 
-	GLFWwindow* window;
+#ifndef HEADLESS_ONLY
+	GLFWwindow* window = NULL;
+#endif
+
+	initBenchConfig(benchConfig);
+
+	bool formatGiven = false;
+	bool benchFailed = false;
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i], "-bump") == 0)
+			bumpMapped = true;
+		else if (strcmp(argv[i], "-headless") == 0 && i + 1 < argc)
+			headlessFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+			capturePrefix = argv[++i];
+		else if (strcmp(argv[i], "-bench") == 0)
+			benchmarking = true;
+		else if (strcmp(argv[i], "-bench-window") == 0)
+			benchmarking = windowedBench = true;
+		else if (strcmp(argv[i], "-bench-frames") == 0 && i + 1 < argc)
+			benchConfig.frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-bench-warmup") == 0 && i + 1 < argc)
+			benchConfig.warmup = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-bench-mesh") == 0 && i + 1 < argc){
+			if (!parseMeshList(argv[++i], benchConfig))
+				exit(EXIT_FAILURE);
+		}
+		else if (strcmp(argv[i], "-bench-instances") == 0 && i + 1 < argc){
+			if (!parseIntList(argv[++i], benchConfig.instances))
+				exit(EXIT_FAILURE);
+		}
+		else if (strcmp(argv[i], "-bench-out") == 0 && i + 1 < argc)
+			benchConfig.outPath = argv[++i];
+		else if (strcmp(argv[i], "-profile") == 0)
+			profiling = true;
+		else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc){
+			profiling = true;
+			tracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-format") == 0 && i + 1 < argc){
+			formatGiven = true;
+			++i;
+			if (strcmp(argv[i], "png") == 0)
+				captureType = CAPTURE_PNG;
+			else if (strcmp(argv[i], "ppm") == 0)
+				captureType = CAPTURE_PPM;
+			else if (strcmp(argv[i], "raw") == 0)
+				captureType = CAPTURE_RAW;
+			else
+				printf("Unknown format '%s'\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc)
+			frameCap = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-vsync") == 0 && i + 1 < argc)
+			swapInterval = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-jobs") == 0 && i + 1 < argc)
+			jobThreadCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-checkalloc") == 0)
+			checkAlloc = true;
+		else if (strcmp(argv[i], "-threaded") == 0)
+			threaded = true;
+		else if (strcmp(argv[i], "-soft") == 0 && i + 1 < argc)
+			softPath = argv[++i];
+		else if (strcmp(argv[i], "-instances") == 0 && i + 1 < argc)
+			startInstances = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-prepass") == 0)
+			prepass = true;
+		else if (strcmp(argv[i], "-sort") == 0)
+			frontToBack = true;
+		else if (strcmp(argv[i], "-overdraw") == 0)
+			overdrawStats = true;
+		else if (strcmp(argv[i], "-deferred") == 0 && i + 1 < argc)
+			deferredLights = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-clustered") == 0 && i + 1 < argc)
+			clusteredLights = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-msaa") == 0 && i + 1 < argc)
+			msaaSamples = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-shadows") == 0)
+			shadows = true;
+		else if (strcmp(argv[i], "-impostors") == 0)
+			impostors = true;
+		else if (strcmp(argv[i], "-tessellate") == 0 && i + 1 < argc)
+			tessEdge = atof(argv[++i]);
+		else if (strcmp(argv[i], "-no-meshopt") == 0)
+			meshOptimize = false;
+		else if (strcmp(argv[i], "-gpumesh") == 0)
+			gpuMesh = true;
+		else if (strcmp(argv[i], "-halfverts") == 0)
+			halfVertices = true;
+		else if (strcmp(argv[i], "-light") == 0 && i + 3 < argc){
+			lightPos.x = atof(argv[++i]);
+			lightPos.y = atof(argv[++i]);
+			lightPos.z = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-size") == 0 && i + 2 < argc){
+			screenWidth = atoi(argv[++i]);
+			screenHeight = atoi(argv[++i]);
+		}
+		else
+			printf("Unknown option '%s'\n", argv[i]);
+	}
 
-	glfwSetErrorCallback(error_callback);
+	if (deferredLights && clusteredLights){
+		printf("Choose one of -deferred and -clustered, using -deferred\n");
+		clusteredLights = 0;
+	}
 
-	if (!glfwInit())
-		exit(EXIT_FAILURE);
+	//the G-buffer has one sample per pixel, it is blitted to a single sampled target
+	if (deferredLights && msaaSamples){
+		printf("The deferred path does not support MSAA, ignoring -msaa\n");
+		msaaSamples = 0;
+	}
 
-	window = glfwCreateWindow(screenHeight, screenWidth, "Caleb Bauermeister : Homework 1", NULL, NULL);
+	initJobs(jobThreadCount);
+	if (checkAlloc)
+		initAllocCheck(CHECKALLOCWARMUP);
 
-	if (!window)
+	if (softPath)
 	{
-		glfwTerminate();
-		exit(EXIT_FAILURE);
+		runSoftware();
+		exit(EXIT_SUCCESS);
 	}
 
-	glfwMakeContextCurrent(window);
-	glfwSetKeyCallback(window, key_callback);
-	glfwSetMouseButtonCallback(window, mouseButton);
-	glfwSetCursorPosCallback(window, mouseMotion);
-	glfwSetWindowSizeCallback(window, windowFunc);
+#ifdef HEADLESS_ONLY
+	//the headless build has no window to fall back to
+	if (headlessFrames == 0)
+		benchmarking = true;
+	windowedBench = false;
+#endif
 
+	if (benchmarking)
+	{
+		//benchmarks default to headless so they run the same on every node
+		if (!windowedBench)
+			headlessFrames = 1;
+
+		if (benchConfig.meshM.empty()){
+			benchConfig.meshM.push_back(40);
+			benchConfig.meshN.push_back(80);
+		}
+		if (benchConfig.instances.empty())
+			benchConfig.instances.push_back(1);
+
+		//a mesh sweep would only repeat the same run
+		if ((impostors || tessEdge > 0) && benchConfig.meshM.size() > 1){
+			printf("Impostors and tessellated spheres have no mesh, benchmarking only %dx%d\n",
+				   benchConfig.meshM[0], benchConfig.meshN[0]);
+			benchConfig.meshM.resize(1);
+			benchConfig.meshN.resize(1);
+		}
+		if (impostors)
+			benchConfig.mode = "impostor";
+		else if (tessEdge > 0)
+			benchConfig.mode = "tessellated";
+		else if (deferredLights)
+			benchConfig.mode = "deferred";
+		else if (clusteredLights)
+			benchConfig.mode = bumpMapped ? "bump-clustered" : "clustered";
+		else if (shadows)
+			benchConfig.mode = bumpMapped ? "bump-shadow" : "shadow";
+		else if (bumpMapped)
+			benchConfig.mode = prepass ? "bump-prepass" : "bump";
+		else if (prepass)
+			benchConfig.mode = "prepass";
+
+		profiling = true;
+	}
+
+	//headless renders are only seen through their files, benchmarks only through their timings
+	if (headlessFrames > 0 && !benchmarking && !capturePrefix){
+		capturePrefix = HEADLESSPREFIX;
+		if (!formatGiven)
+			captureType = CAPTURE_PPM;
+	}
+
+	if (headlessFrames > 0)
+	{
+		if (!initHeadless())
+			exit(EXIT_FAILURE);
+	}
+#ifndef HEADLESS_ONLY
+	else
+	{
+		glfwSetErrorCallback(error_callback);
+
+		if (!glfwInit())
+			exit(EXIT_FAILURE);
+
+		if (msaaSamples)
+			glfwWindowHint(GLFW_SAMPLES, msaaSamples);
+
+		window = glfwCreateWindow(screenWidth, screenHeight, "Caleb Bauermeister : Homework 1", NULL, NULL);
+
+		if (!window)
+		{
+			glfwTerminate();
+			exit(EXIT_FAILURE);
+		}
+
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(swapInterval);
+		glfwSetKeyCallback(window, key_callback);
+		glfwSetMouseButtonCallback(window, mouseButton);
+		glfwSetCursorPosCallback(window, mouseMotion);
+		glfwSetWindowSizeCallback(window, windowFunc);
+	}
+#endif
+
+	//GLEW looks for a GLX display even when the context came from EGL,
+	//the entry points are still loaded so that error is not fatal headless
+	glewExperimental = GL_TRUE;
 	GLint GlewInitResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if (headlessFrames > 0 && GlewInitResult == GLEW_ERROR_NO_GLX_DISPLAY)
+		GlewInitResult = GLEW_OK;
+#endif
 	if (GLEW_OK != GlewInitResult)
 	{
 		printf("ERROR: %s\n", glewGetErrorString(GlewInitResult));
 		exit(EXIT_FAILURE);
 	}
+
+	if (headlessFrames > 0 && !createHeadlessTarget(screenWidth, screenHeight, msaaSamples))
+		exit(EXIT_FAILURE);
 	
 	init();
 
-	while (!glfwWindowShouldClose(window)){
+	if (capturePrefix)
+		initCapture(capturePrefix, captureType);
 
-		idle();
-		display();
+	if (profiling)
+		initProfiler(true, tracePath);
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	if (overdrawStats)
+		initOverdraw();
+
+	if (headlessFrames > 0)
+	{
+		//match the projection to the offscreen target
+		windowFunc(NULL, screenWidth, screenHeight);
+
+		if (benchmarking)
+			benchFailed = !runBenchmark(benchConfig, benchSetup, benchFrame);
+		else
+			runHeadless();
+
+		if (capturePrefix)
+			finishCapture();
+
+		shutdownOverdraw();
+		shutdownDeferred();
+		shutdownClustered();
+		shutdownSphereCompute();
+		shutdownShadows();
+		shutdownProfiler();
+
+		shutdownHeadless();
+		exit(benchFailed || allocCheckFailed() ? EXIT_FAILURE : EXIT_SUCCESS);
 	}
 
+#ifndef HEADLESS_ONLY
+	if (benchmarking)
+	{
+		//measure rendering, not the display refresh rate
+		glfwSwapInterval(0);
+		benchWindow = window;
+		benchFailed = !runBenchmark(benchConfig, benchSetup, benchFrame);
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	if (threaded)
+	{
+		runThreaded(window);
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		exit(benchFailed || allocCheckFailed() ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	FrameLimiter limiter;
+	initFrameLimiter(limiter, frameCap);
+	double lastTime = timestepNow();
+
+	while (!glfwWindowShouldClose(window) && !allocCheckFailed()){
+
+		allocFrameBegin();
+		profileFrameBegin();
+
+		{
+			PROFILE_SCOPE("limit");
+			waitFrameLimiter(limiter);
+		}
+
+		//input is read as late as possible, right before the frame that shows it
+		{
+			PROFILE_SCOPE("poll");
+			glfwPollEvents();
+		}
+
+		double now = timestepNow();
+		renderFrame(now - lastTime);
+		lastTime = now;
+
+		{
+			PROFILE_SCOPE("swap");
+			glfwSwapBuffers(window);
+		}
+
+		profileFrameEnd();
+		allocFrameEnd();
+	}
+
+	if (capturePrefix)
+		finishCapture();
+
+	shutdownOverdraw();
+	shutdownDeferred();
+	shutdownClustered();
+	shutdownSphereCompute();
+	shutdownShadows();
+	shutdownProfiler();
+
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
-	exit(EXIT_SUCCESS);
+#endif
+	exit(benchFailed || allocCheckFailed() ? EXIT_FAILURE : EXIT_SUCCESS);
 }
@@ -8,15 +8,30 @@
 #define __MAT_H__
 
 #include <iostream>
+#include <cstdio>
 #include "openglutl.h"
 #include "vec.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MAT_SSE
+#endif
+
 //----------------------------------------------------------------------------
 //
 //  mat2 - 2D square matrix
 //
 
-class mat2 {
+#ifdef CS419_VEC_EXPR
+class mat2;
+template <> struct ExprTraits<mat2> { enum { size = 4, vector = 0 }; typedef vec2 row; };
+#endif
+
+class mat2
+#ifdef CS419_VEC_EXPR
+	: public Expr<mat2, mat2>
+#endif
+{
 	vec2  _m[2];
 
    public:
@@ -33,13 +48,6 @@ class mat2 {
 	mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )
 	{ _m[0] = vec2( m00, m01 ); _m[1] = vec2( m10, m11 ); }
 
-	mat2( const mat2& m ) {
-	if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-	}
-	}
-
 	//
 	//  --- Indexing Operator ---
 	//
@@ -51,6 +59,7 @@ class mat2 {
 	//  --- (non-modifying) Arithmetic Operators ---
 	//
 
+#ifndef CS419_VEC_EXPR
 	mat2 operator + ( const mat2& m ) const
 	{ return mat2( _m[0]+m[0], _m[1]+m[1] ); }
 
@@ -75,6 +84,14 @@ class mat2 {
 
 	friend mat2 operator * ( const GLfloat s, const mat2& m )
 	{ return m * s; }
+#else
+	//members like m * v, the templates in vecexpr.h would be ambiguous with those
+	ScaleExpr<mat2, mat2> operator * ( const GLfloat s ) const
+	{ return ScaleExpr<mat2, mat2>( *this, s ); }
+
+	ScaleExpr<mat2, mat2> operator / ( const GLfloat s ) const
+	{ return ScaleExpr<mat2, mat2>( *this, GLfloat(1.0) / s ); }
+#endif // CS419_VEC_EXPR
 
 	mat2 operator * ( const mat2& m ) const {
 	mat2  a( 0.0 );
@@ -170,16 +187,18 @@ class mat2 {
 //  --- Non-class mat2 Methods ---
 //
 
+//the element constructors take their arguments column by column
+
 inline
 mat2 matrixCompMult( const mat2& A, const mat2& B ) {
-	return mat2( A[0][0]*B[0][0], A[0][1]*B[0][1],
-		 A[1][0]*B[1][0], A[1][1]*B[1][1] );
+	return mat2( A[0][0]*B[0][0], A[1][0]*B[1][0],
+		 A[0][1]*B[0][1], A[1][1]*B[1][1] );
 }
 
 inline
 mat2 transpose( const mat2& A ) {
-	return mat2( A[0][0], A[1][0],
-		 A[0][1], A[1][1] );
+	return mat2( A[0][0], A[0][1],
+		 A[1][0], A[1][1] );
 }
 
 //----------------------------------------------------------------------------
@@ -187,7 +206,16 @@ mat2 transpose( const mat2& A ) {
 //  mat3 - 3D square matrix
 //
 
-class mat3 {
+#ifdef CS419_VEC_EXPR
+class mat3;
+template <> struct ExprTraits<mat3> { enum { size = 9, vector = 0 }; typedef vec3 row; };
+#endif
+
+class mat3
+#ifdef CS419_VEC_EXPR
+	: public Expr<mat3, mat3>
+#endif
+{
 	vec3  _m[3];
 
    public:
@@ -210,15 +238,6 @@ class mat3 {
 		_m[2] = vec3( m20, m21, m22 );
 	}
 
-	mat3( const mat3& m )
-	{
-		if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-		}
-	}
-
 	//
 	//  --- Indexing Operator ---
 	//
@@ -230,6 +249,7 @@ class mat3 {
 	//  --- (non-modifying) Arithmetic Operators ---
 	//
 
+#ifndef CS419_VEC_EXPR
 	mat3 operator + ( const mat3& m ) const
 	{ return mat3( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2] ); }
 
@@ -254,6 +274,14 @@ class mat3 {
 
 	friend mat3 operator * ( const GLfloat s, const mat3& m )
 	{ return m * s; }
+#else
+	//members like m * v, the templates in vecexpr.h would be ambiguous with those
+	ScaleExpr<mat3, mat3> operator * ( const GLfloat s ) const
+	{ return ScaleExpr<mat3, mat3>( *this, s ); }
+
+	ScaleExpr<mat3, mat3> operator / ( const GLfloat s ) const
+	{ return ScaleExpr<mat3, mat3>( *this, GLfloat(1.0) / s ); }
+#endif // CS419_VEC_EXPR
 
 	mat3 operator * ( const mat3& m ) const {
 	mat3  a( 0.0 );
@@ -356,16 +384,16 @@ class mat3 {
 
 inline
 mat3 matrixCompMult( const mat3& A, const mat3& B ) {
-	return mat3( A[0][0]*B[0][0], A[0][1]*B[0][1], A[0][2]*B[0][2],
-		 A[1][0]*B[1][0], A[1][1]*B[1][1], A[1][2]*B[1][2],
-		 A[2][0]*B[2][0], A[2][1]*B[2][1], A[2][2]*B[2][2] );
+	return mat3( A[0][0]*B[0][0], A[1][0]*B[1][0], A[2][0]*B[2][0],
+		 A[0][1]*B[0][1], A[1][1]*B[1][1], A[2][1]*B[2][1],
+		 A[0][2]*B[0][2], A[1][2]*B[1][2], A[2][2]*B[2][2] );
 }
 
 inline
 mat3 transpose( const mat3& A ) {
-	return mat3( A[0][0], A[1][0], A[2][0],
-		 A[0][1], A[1][1], A[2][1],
-		 A[0][2], A[1][2], A[2][2] );
+	return mat3( A[0][0], A[0][1], A[0][2],
+		 A[1][0], A[1][1], A[1][2],
+		 A[2][0], A[2][1], A[2][2] );
 }
 
 //----------------------------------------------------------------------------
@@ -373,7 +401,16 @@ mat3 transpose( const mat3& A ) {
 //  mat4.h - 4D square matrix
 //
 
-class mat4 {
+#ifdef CS419_VEC_EXPR
+class mat4;
+template <> struct ExprTraits<mat4> { enum { size = 16, vector = 0 }; typedef vec4 row; };
+#endif
+
+class mat4
+#ifdef CS419_VEC_EXPR
+	: public Expr<mat4, mat4>
+#endif
+{
 	vec4  _m[4];
 
    public:
@@ -398,16 +435,6 @@ class mat4 {
 		_m[3] = vec4( m30, m31, m32, m33 );
 	}
 
-	mat4( const mat4& m )
-	{
-		if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-		_m[3] = m._m[3];
-		}
-	}
-
 	//
 	//  --- Indexing Operator ---
 	//
@@ -419,6 +446,7 @@ class mat4 {
 	//  --- (non-modifying) Arithmetic Operators ---
 	//
 
+#ifndef CS419_VEC_EXPR
 	mat4 operator + ( const mat4& m ) const
 	{ return mat4( _m[0]+m[0], _m[1]+m[1], _m[2]+m[2], _m[3]+m[3] ); }
 
@@ -443,6 +471,14 @@ class mat4 {
 
 	friend mat4 operator * ( const GLfloat s, const mat4& m )
 	{ return m * s; }
+#else
+	//members like m * v, the templates in vecexpr.h would be ambiguous with those
+	ScaleExpr<mat4, mat4> operator * ( const GLfloat s ) const
+	{ return ScaleExpr<mat4, mat4>( *this, s ); }
+
+	ScaleExpr<mat4, mat4> operator / ( const GLfloat s ) const
+	{ return ScaleExpr<mat4, mat4>( *this, GLfloat(1.0) / s ); }
+#endif // CS419_VEC_EXPR
 
 	mat4 operator * ( const mat4& m ) const {
 	mat4  a( 0.0 );
@@ -549,18 +585,178 @@ class mat4 {
 inline
 mat4 matrixCompMult( const mat4& A, const mat4& B ) {
 	return mat4(
-	A[0][0]*B[0][0], A[0][1]*B[0][1], A[0][2]*B[0][2], A[0][3]*B[0][3],
-	A[1][0]*B[1][0], A[1][1]*B[1][1], A[1][2]*B[1][2], A[1][3]*B[1][3],
-	A[2][0]*B[2][0], A[2][1]*B[2][1], A[2][2]*B[2][2], A[2][3]*B[2][3],
-	A[3][0]*B[3][0], A[3][1]*B[3][1], A[3][2]*B[3][2], A[3][3]*B[3][3] );
+	A[0][0]*B[0][0], A[1][0]*B[1][0], A[2][0]*B[2][0], A[3][0]*B[3][0],
+	A[0][1]*B[0][1], A[1][1]*B[1][1], A[2][1]*B[2][1], A[3][1]*B[3][1],
+	A[0][2]*B[0][2], A[1][2]*B[1][2], A[2][2]*B[2][2], A[3][2]*B[3][2],
+	A[0][3]*B[0][3], A[1][3]*B[1][3], A[2][3]*B[2][3], A[3][3]*B[3][3] );
 }
 
 inline
 mat4 transpose( const mat4& A ) {
-	return mat4( A[0][0], A[1][0], A[2][0], A[3][0],
-		 A[0][1], A[1][1], A[2][1], A[3][1],
-		 A[0][2], A[1][2], A[2][2], A[3][2],
-		 A[0][3], A[1][3], A[2][3], A[3][3] );
+	return mat4( A[0][0], A[0][1], A[0][2], A[0][3],
+		 A[1][0], A[1][1], A[1][2], A[1][3],
+		 A[2][0], A[2][1], A[2][2], A[2][3],
+		 A[3][0], A[3][1], A[3][2], A[3][3] );
+}
+
+//----------------------------------------------------------------------------
+//
+//  mat3x4 - affine transform, the top three rows of a mat4 whose last row
+//    is (0, 0, 0, 1), so it takes 12 floats and composes with 36 multiplies
+//    instead of 64
+//
+
+class mat3x4 {
+	vec4  _m[3];
+
+   public:
+	//
+	//  --- Constructors and Destructors ---
+	//
+
+	mat3x4( const GLfloat d = GLfloat(1.0) )  // Create a diagonal matrix
+	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d; }
+
+	mat3x4( const vec4& a, const vec4& b, const vec4& c )
+	{ _m[0] = a;  _m[1] = b;  _m[2] = c; }
+
+	//drops the last row, m must be affine e.g. from Translate, Scale, Rotate or LookAt
+	explicit mat3x4( const mat4& m )
+	{ _m[0] = m[0];  _m[1] = m[1];  _m[2] = m[2]; }
+
+	//
+	//  --- Indexing Operator ---
+	//
+
+	vec4& operator [] ( int i ) { return _m[i]; }
+	const vec4& operator [] ( int i ) const { return _m[i]; }
+
+	//
+	//  --- Composition ---
+	//
+
+	//each row is a combination of the rows of m, the implied last row adds the translation
+	mat3x4 operator * ( const mat3x4& m ) const {
+	mat3x4  a;
+
+#ifdef MAT_SSE
+	//the compiler's own vectorization of the scalar loop is slower than mat4's
+	__m128 m0 = _mm_loadu_ps( &m[0].x );
+	__m128 m1 = _mm_loadu_ps( &m[1].x );
+	__m128 m2 = _mm_loadu_ps( &m[2].x );
+	__m128 m3 = _mm_set_ps( 1.0f, 0.0f, 0.0f, 0.0f );
+	__m128 r[3];
+
+	for ( int i = 0; i < 3; ++i ) {
+		r[i] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( _m[i].x ), m0 ),
+				   _mm_mul_ps( _mm_set1_ps( _m[i].y ), m1 ) ),
+			   _mm_add_ps( _mm_mul_ps( _mm_set1_ps( _m[i].z ), m2 ),
+				   _mm_mul_ps( _mm_set1_ps( _m[i].w ), m3 ) ) );
+	}
+
+	for ( int i = 0; i < 3; ++i ) {
+		_mm_storeu_ps( &a[i].x, r[i] );
+	}
+#else
+	for ( int i = 0; i < 3; ++i ) {
+		for ( int j = 0; j < 4; ++j ) {
+		a[i][j] = _m[i][0]*m[0][j] + _m[i][1]*m[1][j] + _m[i][2]*m[2][j];
+		}
+		a[i][3] += _m[i][3];
+	}
+#endif
+
+	return a;
+	}
+
+	mat3x4& operator *= ( const mat3x4& m )
+	{ return *this = *this * m; }
+
+	//
+	//  --- Matrix / Vector operators ---
+	//
+
+	vec4 operator * ( const vec4& v ) const {  // m * v, w passes through
+	return vec4( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
+			 _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
+			 _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
+			 v.w
+		);
+	}
+
+	//
+	//  --- Insertion and Extraction Operators ---
+	//
+
+	friend std::ostream& operator << ( std::ostream& os, const mat3x4& m ) {
+	return os << std::endl
+		  << m[0] << std::endl
+		  << m[1] << std::endl
+		  << m[2] << std::endl;
+	}
+
+	//
+	//  --- Conversion Operators ---
+	//
+
+	//row major, upload with glUniformMatrix4x3fv and transpose GL_TRUE
+	operator const GLfloat* () const
+	{ return static_cast<const GLfloat*>( &_m[0].x ); }
+
+	operator GLfloat* ()
+	{ return static_cast<GLfloat*>( &_m[0].x ); }
+};
+
+//
+//  --- Non-class mat3x4 Methods ---
+//
+
+inline
+mat4 toMat4( const mat3x4& A ) {
+	return mat4( A[0], A[1], A[2], vec4( 0.0, 0.0, 0.0, 1.0 ) );
+}
+
+inline
+vec3 transformPoint( const mat3x4& A, const vec3& p ) {
+	return vec3( A[0][0]*p.x + A[0][1]*p.y + A[0][2]*p.z + A[0][3],
+		 A[1][0]*p.x + A[1][1]*p.y + A[1][2]*p.z + A[1][3],
+		 A[2][0]*p.x + A[2][1]*p.y + A[2][2]*p.z + A[2][3] );
+}
+
+//directions ignore the translation
+inline
+vec3 transformVector( const mat3x4& A, const vec3& v ) {
+	return vec3( A[0][0]*v.x + A[0][1]*v.y + A[0][2]*v.z,
+		 A[1][0]*v.x + A[1][1]*v.y + A[1][2]*v.z,
+		 A[2][0]*v.x + A[2][1]*v.y + A[2][2]*v.z );
+}
+
+//inverse of the upper 3x3 from its cofactors, then the translation moved back through it
+inline
+mat3x4 inverse( const mat3x4& A ) {
+	GLfloat c00 = A[1][1]*A[2][2] - A[1][2]*A[2][1];
+	GLfloat c01 = A[1][2]*A[2][0] - A[1][0]*A[2][2];
+	GLfloat c02 = A[1][0]*A[2][1] - A[1][1]*A[2][0];
+
+	GLfloat invDet = GLfloat(1.0) / ( A[0][0]*c00 + A[0][1]*c01 + A[0][2]*c02 );
+
+	vec3 r0( c00, A[0][2]*A[2][1] - A[0][1]*A[2][2], A[0][1]*A[1][2] - A[0][2]*A[1][1] );
+	vec3 r1( c01, A[0][0]*A[2][2] - A[0][2]*A[2][0], A[0][2]*A[1][0] - A[0][0]*A[1][2] );
+	vec3 r2( c02, A[0][1]*A[2][0] - A[0][0]*A[2][1], A[0][0]*A[1][1] - A[0][1]*A[1][0] );
+	r0 *= invDet;  r1 *= invDet;  r2 *= invDet;
+
+	vec3 t( A[0][3], A[1][3], A[2][3] );
+	return mat3x4( vec4( r0, -dot( r0, t ) ), vec4( r1, -dot( r1, t ) ), vec4( r2, -dot( r2, t ) ) );
+}
+
+//inverse of a rotation and translation only, the transpose undoes the rotation
+inline
+mat3x4 rigidInverse( const mat3x4& A ) {
+	vec3 t( A[0][3], A[1][3], A[2][3] );
+	vec3 r0( A[0][0], A[1][0], A[2][0] );
+	vec3 r1( A[0][1], A[1][1], A[2][1] );
+	vec3 r2( A[0][2], A[1][2], A[2][2] );
+	return mat3x4( vec4( r0, -dot( r0, t ) ), vec4( r1, -dot( r1, t ) ), vec4( r2, -dot( r2, t ) ) );
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -764,21 +960,57 @@ mat4 LookAt( const vec4& eye, const vec4& at, const vec4& up )
 inline
 mat3 Normal( const mat4& c)
 {
+   //inverse transpose of the upper 3x3, i.e. the cofactors over the determinant
    mat3 d;
-   GLfloat det;
-   det = c[0][0]*c[1][1]*c[2][2]+c[0][1]*c[1][2]*c[2][1]
-	 -c[2][0]*c[1][1]*c[0][2]-c[1][0]*c[0][1]*c[2][2]-c[0][0]*c[1][2]*c[2][1];
-   d[0][0] = (c[1][1]*c[2][2]-c[1][2]*c[2][1])/det;
-   d[0][1] = -(c[0][1]*c[2][2]-c[0][2]*c[2][1])/det;
-   d[0][2] = (c[0][1]*c[2][0]-c[2][1]*c[2][2])/det;
-   d[1][0] = -(c[0][1]*c[2][2]-c[0][2]*c[2][1])/det;
-   d[1][1] = (c[0][0]*c[2][2]-c[0][2]*c[2][0])/det;
-   d[1][2] = -(c[0][0]*c[2][1]-c[2][0]*c[0][1])/det;
-   d[2][0] = (c[0][1]*c[1][2]-c[1][1]*c[0][2])/det;
-   d[2][1] = -(c[0][0]*c[1][2]-c[0][2]*c[1][0])/det;
-   d[2][2] = (c[0][0]*c[1][1]-c[1][0]*c[0][1])/det;
-
-  return d;
+   d[0][0] =  (c[1][1]*c[2][2]-c[1][2]*c[2][1]);
+   d[0][1] = -(c[1][0]*c[2][2]-c[1][2]*c[2][0]);
+   d[0][2] =  (c[1][0]*c[2][1]-c[1][1]*c[2][0]);
+   d[1][0] = -(c[0][1]*c[2][2]-c[0][2]*c[2][1]);
+   d[1][1] =  (c[0][0]*c[2][2]-c[0][2]*c[2][0]);
+   d[1][2] = -(c[0][0]*c[2][1]-c[0][1]*c[2][0]);
+   d[2][0] =  (c[0][1]*c[1][2]-c[0][2]*c[1][1]);
+   d[2][1] = -(c[0][0]*c[1][2]-c[0][2]*c[1][0]);
+   d[2][2] =  (c[0][0]*c[1][1]-c[0][1]*c[1][0]);
+
+   GLfloat det = c[0][0]*d[0][0] + c[0][1]*d[0][1] + c[0][2]*d[0][2];
+
+  return d / det;
+}
+
+//----------------------------------------------------------------------------
+//
+// General 4x4 inverse by Gauss-Jordan elimination with partial pivoting,
+// e.g. to unproject with a projection matrix
+//
+inline
+mat4 inverse( const mat4& m )
+{
+	mat4 a = m;
+	mat4 result;
+
+	for ( int col = 0; col < 4; ++col ) {
+		int pivot = col;
+		for ( int row = col + 1; row < 4; ++row )
+			if ( fabs(a[row][col]) > fabs(a[pivot][col]) )
+				pivot = row;
+
+		vec4 swap = a[col]; a[col] = a[pivot]; a[pivot] = swap;
+		swap = result[col]; result[col] = result[pivot]; result[pivot] = swap;
+
+		GLfloat scale = 1.0f / a[col][col];
+		a[col] *= scale;
+		result[col] *= scale;
+
+		for ( int row = 0; row < 4; ++row ) {
+			if ( row == col )
+				continue;
+			GLfloat factor = a[row][col];
+			a[row] -= factor * a[col];
+			result[row] -= factor * result[col];
+		}
+	}
+
+	return result;
 }
 
 //----------------------------------------------------------------------------
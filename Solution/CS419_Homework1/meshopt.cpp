@@ -0,0 +1,210 @@
+#include <cmath>
+#include "meshopt.h"
+
+#pragma region analysis
+
+CacheStats analyzeVertexCache(const std::vector<GLuint>& indices, int vertexCount, int cacheSize)
+{
+	//FIFO like most hardware, a hit does not refresh the entry
+	std::vector<int> cache(cacheSize, -1);
+	std::vector<int> slot(vertexCount, -1);
+	int next = 0;
+	int misses = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i){
+		int v = indices[i];
+		if (slot[v] >= 0 && cache[slot[v]] == v)
+			continue;
+
+		++misses;
+		if (cache[next] >= 0)
+			slot[cache[next]] = -1;
+		cache[next] = v;
+		slot[v] = next;
+		next = (next + 1) % cacheSize;
+	}
+
+	std::vector<bool> used(vertexCount, false);
+	int usedCount = 0;
+	for (size_t i = 0; i < indices.size(); ++i){
+		if (!used[indices[i]]){
+			used[indices[i]] = true;
+			++usedCount;
+		}
+	}
+
+	CacheStats stats;
+	stats.acmr = indices.empty() ? 0.0f : float(misses) / (indices.size() / 3);
+	stats.atvr = usedCount ? float(misses) / usedCount : 0.0f;
+	return stats;
+}
+
+//analysis
+#pragma endregion
+
+#pragma region vertex cache
+
+//size of the LRU cache the scores model
+#define SCORECACHE 32
+
+//tuning constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+#define CACHEDECAYPOWER 1.5f
+#define LASTTRISCORE 0.75f
+#define VALENCEBOOSTSCALE 2.0f
+#define VALENCEBOOSTPOWER 0.5f
+
+//vertices in the cache score by recency, the three of the last triangle a fixed amount
+//so strips do not always win, vertices with few triangles left get a boost so
+//they are finished off rather than left behind as stragglers
+static float vertexScore(int cachePosition, int remaining)
+{
+	if (remaining == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0){
+		if (cachePosition < 3)
+			score = LASTTRISCORE;
+		else
+			score = powf(1.0f - float(cachePosition - 3) / (SCORECACHE - 3), CACHEDECAYPOWER);
+	}
+
+	return score + VALENCEBOOSTSCALE * powf(float(remaining), -VALENCEBOOSTPOWER);
+}
+
+void optimizeVertexCache(std::vector<GLuint>& indices, int vertexCount)
+{
+	int triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//triangles of every vertex, packed
+	std::vector<int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); ++i)
+		++remaining[indices[i]];
+
+	std::vector<int> first(vertexCount + 1, 0);
+	for (int v = 0; v < vertexCount; ++v)
+		first[v + 1] = first[v] + remaining[v];
+
+	std::vector<int> adjacency(indices.size());
+	std::vector<int> filled(first.begin(), first.end() - 1);
+	for (int t = 0; t < triangleCount; ++t){
+		for (int k = 0; k < 3; ++k)
+			adjacency[filled[indices[t * 3 + k]]++] = t;
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (int v = 0; v < vertexCount; ++v)
+		score[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (int t = 0; t < triangleCount; ++t)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	//LRU order, three extra slots for the vertices pushed in before the oldest fall out
+	std::vector<int> cache;
+	cache.reserve(SCORECACHE + 3);
+
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+
+	int best = 0;
+	for (int t = 1; t < triangleCount; ++t)
+		if (triangleScore[t] > triangleScore[best])
+			best = t;
+
+	int scan = 0;
+	std::vector<int> updated;
+	while (best >= 0){
+		emitted[best] = true;
+
+		//the triangle's vertices go to the front of the cache
+		updated.clear();
+		for (int k = 0; k < 3; ++k){
+			int v = indices[best * 3 + k];
+			result.push_back(v);
+
+			for (int i = first[v]; i < first[v] + remaining[v]; ++i){
+				if (adjacency[i] == best){
+					adjacency[i] = adjacency[first[v] + remaining[v] - 1];
+					break;
+				}
+			}
+			--remaining[v];
+
+			updated.push_back(v);
+		}
+
+		for (size_t i = 0; i < cache.size(); ++i){
+			int v = cache[i];
+			if (v != (int)indices[best * 3] && v != (int)indices[best * 3 + 1] && v != (int)indices[best * 3 + 2])
+				updated.push_back(v);
+		}
+
+		cache.clear();
+		for (size_t i = 0; i < updated.size(); ++i){
+			int v = updated[i];
+			if (i < SCORECACHE){
+				cache.push_back(v);
+				cachePosition[v] = i;
+			}
+			else
+				cachePosition[v] = -1;
+		}
+
+		//rescore the touched vertices and their triangles, the best of those comes next
+		for (size_t i = 0; i < updated.size(); ++i){
+			int v = updated[i];
+			score[v] = vertexScore(cachePosition[v], remaining[v]);
+		}
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < updated.size(); ++i){
+			int v = updated[i];
+			for (int a = first[v]; a < first[v] + remaining[v]; ++a){
+				int t = adjacency[a];
+				float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				triangleScore[t] = s;
+				if (s > bestScore){
+					bestScore = s;
+					best = t;
+				}
+			}
+		}
+
+		//nothing left next to the cache, start over at the first triangle not yet drawn
+		if (best < 0){
+			while (scan < triangleCount && emitted[scan])
+				++scan;
+			if (scan < triangleCount)
+				best = scan;
+		}
+	}
+
+	indices.swap(result);
+}
+
+//vertex cache
+#pragma endregion
+
+void optimizeVertexFetch(std::vector<GLuint>& indices, int vertexCount, std::vector<GLuint>& remap)
+{
+	const GLuint unused = GLuint(-1);
+	remap.assign(vertexCount, unused);
+
+	GLuint next = 0;
+	for (size_t i = 0; i < indices.size(); ++i){
+		GLuint& v = indices[i];
+		if (remap[v] == unused)
+			remap[v] = next++;
+		v = remap[v];
+	}
+
+	for (int v = 0; v < vertexCount; ++v)
+		if (remap[v] == unused)
+			remap[v] = next++;
+}
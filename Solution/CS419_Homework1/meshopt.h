@@ -0,0 +1,38 @@
+#ifndef __MESHOPT__
+#define __MESHOPT__
+
+#include <vector>
+#include "openglutl.h"
+
+//index and vertex reordering for indexed triangle lists
+//the GPU keeps recently transformed vertices in a small post-transform cache, a triangle
+//order that reuses them shades each vertex closer to once, and a vertex order that
+//follows the triangles makes the fetches sequential
+
+//vertex cache efficiency of a triangle order on a FIFO cache of cacheSize entries
+struct CacheStats{
+	float	acmr;	//transformed vertices per triangle, 0.5 at best for a big regular mesh
+	float	atvr;	//transformed vertices per vertex, 1.0 at best
+};
+
+CacheStats analyzeVertexCache(const std::vector<GLuint>& indices, int vertexCount, int cacheSize = 16);
+
+//reorder triangles for the post-transform cache with Tom Forsyth's linear-speed algorithm,
+//the triangles and their winding are kept, only their order changes
+void optimizeVertexCache(std::vector<GLuint>& indices, int vertexCount);
+
+//renumber the vertices in the order the indices first use them and rewrite the indices,
+//remap[old] is the new position of each vertex, unused vertices go last
+void optimizeVertexFetch(std::vector<GLuint>& indices, int vertexCount, std::vector<GLuint>& remap);
+
+//move the elements of a vertex stream to the positions remap gives them
+template <class T>
+void remapVertices(std::vector<T>& vertices, const std::vector<GLuint>& remap)
+{
+	std::vector<T> result(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		result[remap[i]] = vertices[i];
+	vertices.swap(result);
+}
+
+#endif //__MESHOPT__
@@ -0,0 +1,182 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "microbench.h"
+
+#ifdef _MSC_VER
+volatile const void* microbenchSink = 0;
+#endif
+
+struct MicroBench{
+	const char*		name;
+	MicroBenchFunc	func;
+};
+
+struct MicroResult{
+	const char*	name;
+	long long	iterations;
+	double		nsMin;
+	double		nsMedian;
+};
+
+//function local so registration from other files does not depend on initialization order
+static std::vector<MicroBench>& registry()
+{
+	static std::vector<MicroBench> benches;
+	return benches;
+}
+
+MicroBenchRegister::MicroBenchRegister(const char* name, MicroBenchFunc func)
+{
+	MicroBench bench = { name, func };
+	registry().push_back(bench);
+}
+
+static double timeRun(MicroBenchFunc func, long long iterations)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	func(iterations);
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//grow the iteration count until one run takes at least minTime
+static long long calibrate(MicroBenchFunc func, double minTime)
+{
+	long long iterations = 1;
+	for (;;){
+		double seconds = timeRun(func, iterations);
+		if (seconds >= minTime || iterations >= (1LL << 40))
+			return iterations;
+
+		//aim a little past minTime, but never grow more than 10x at once
+		double scale = seconds > 0.0 ? 1.2 * minTime / seconds : 10.0;
+		scale = std::min(std::max(scale, 2.0), 10.0);
+		iterations = (long long)(iterations * scale);
+	}
+}
+
+//reads the ns_median values of a file written by --json
+static bool readBaseline(const char* path, std::vector<MicroResult>& results, std::vector<char*>& names)
+{
+	FILE* file = fopen(path, "r");
+	if (!file){
+		printf("Failed to open %s\n", path);
+		return false;
+	}
+
+	char line[512];
+	while (fgets(line, sizeof(line), file)){
+		char* name = strstr(line, "\"name\":\"");
+		char* median = strstr(line, "\"ns_median\":");
+		if (!name || !median)
+			continue;
+
+		name += 8;
+		char* end = strchr(name, '"');
+		if (!end)
+			continue;
+		*end = '\0';
+
+		MicroResult result = { NULL, 0, 0.0, atof(median + 12) };
+		names.push_back(strdup(name));
+		result.name = names.back();
+		results.push_back(result);
+	}
+
+	fclose(file);
+	return true;
+}
+
+static void writeJson(const char* path, const std::vector<MicroResult>& results)
+{
+	FILE* file = fopen(path, "w");
+	if (!file){
+		printf("Failed to open %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	//one benchmark per line so the baseline reader needs no JSON parser
+	fprintf(file, "{\"benchmarks\":[\n");
+	for (size_t i = 0; i < results.size(); ++i){
+		fprintf(file, "{\"name\":\"%s\",\"iterations\":%lld,\"ns_min\":%.4f,\"ns_median\":%.4f}%s\n",
+				results[i].name, results[i].iterations, results[i].nsMin, results[i].nsMedian,
+				i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "]}\n");
+
+	fclose(file);
+	printf("Wrote results to %s\n", path);
+}
+
+int runMicrobenchmarks(int argc, char** argv)
+{
+	const char* filter = NULL;
+	const char* jsonPath = NULL;
+	const char* baselinePath = NULL;
+	int repeats = 5;
+	double minTime = 0.05;
+
+	for (int i = 1; i < argc; ++i){
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			filter = argv[++i];
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+			repeats = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+			minTime = atof(argv[++i]);
+		else{
+			printf("Usage: %s [--filter text] [--repeats N] [--min-time seconds] [--json out.json] [--baseline old.json]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<MicroResult> baseline;
+	std::vector<char*> baselineNames;
+	if (baselinePath && !readBaseline(baselinePath, baseline, baselineNames))
+		return EXIT_FAILURE;
+
+	printf("%-24s %14s %10s %10s", "benchmark", "iterations", "ns min", "ns median");
+	if (baselinePath)
+		printf(" %10s %8s", "baseline", "change");
+	printf("\n");
+
+	std::vector<MicroResult> results;
+	std::vector<double> runs(repeats);
+	const std::vector<MicroBench>& benches = registry();
+
+	for (size_t b = 0; b < benches.size(); ++b){
+		if (filter && !strstr(benches[b].name, filter))
+			continue;
+
+		long long iterations = calibrate(benches[b].func, minTime);
+		for (int r = 0; r < repeats; ++r)
+			runs[r] = timeRun(benches[b].func, iterations) * 1.0e9 / iterations;
+		std::sort(runs.begin(), runs.end());
+
+		MicroResult result = { benches[b].name, iterations, runs[0], runs[repeats / 2] };
+		results.push_back(result);
+
+		printf("%-24s %14lld %10.3f %10.3f", result.name, iterations, result.nsMin, result.nsMedian);
+		for (size_t i = 0; i < baseline.size(); ++i){
+			if (strcmp(baseline[i].name, result.name) == 0){
+				printf(" %10.3f %+7.1f%%", baseline[i].nsMedian, 100.0 * (result.nsMedian / baseline[i].nsMedian - 1.0));
+				break;
+			}
+		}
+		printf("\n");
+	}
+
+	for (size_t i = 0; i < baselineNames.size(); ++i)
+		free(baselineNames[i]);
+
+	if (jsonPath)
+		writeJson(jsonPath, results);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#ifndef __MICROBENCH__
+#define __MICROBENCH__
+
+//tiny microbenchmark harness in the spirit of Google Benchmark
+//a benchmark is a function that runs its body the given number of times,
+//the runner picks the count so one run lasts long enough to time and repeats it
+//
+//	MICROBENCH(vec4_add){
+//		for (long long i = 0; i < iterations; ++i)
+//			doNotOptimize(a + b);
+//	}
+//
+//command line: --filter text --repeats N --min-time seconds --json out.json --baseline old.json
+
+typedef void (*MicroBenchFunc)(long long iterations);
+
+//adds a benchmark to the list, used through MICROBENCH
+struct MicroBenchRegister{
+	MicroBenchRegister(const char* name, MicroBenchFunc func);
+};
+
+#define MICROBENCH(name) \
+	static void microbench_##name(long long iterations); \
+	static MicroBenchRegister microbenchRegister_##name(#name, microbench_##name); \
+	static void microbench_##name(long long iterations)
+
+//keeps the compiler from discarding a value or hoisting its computation out of the loop
+#ifdef _MSC_VER
+#include <intrin.h>
+extern volatile const void* microbenchSink;
+template <class T> inline void doNotOptimize(const T& value)
+{
+	microbenchSink = &value;
+	_ReadWriteBarrier();
+}
+#else
+template <class T> inline void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+#endif
+
+//run the registered benchmarks, returns the process exit code
+int runMicrobenchmarks(int argc, char** argv);
+
+#endif //__MICROBENCH__
@@ -1,8 +1,10 @@
 #include <iostream>
 #include <fstream>
 #include "openglutl.h"
+#include "arena.h"
 
-static char* readShaderSource(const char* shaderFile)
+//the source goes into arena, the caller releases it
+static char* readShaderSource(const char* shaderFile, Arena& arena)
 {
 	std::ifstream file(shaderFile, std::ifstream::binary);
 
@@ -14,7 +16,7 @@ static char* readShaderSource(const char* shaderFile)
 	long size = file.tellg();
 
 	file.seekg(0, std::ios::beg);
-	char* buf = new char[size + 1];
+	char* buf = arenaArray<char>(arena, size + 1);
 	file.read(buf, size);
 
 	buf[size] = '\0';
@@ -23,71 +25,48 @@ static char* readShaderSource(const char* shaderFile)
 	return buf;
 }
 
-GLuint InitShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile)
+//read and compile one shader, exits with the log on failure
+static GLuint compileShader(const char* filename, GLenum type)
 {
-	struct Shader{
-		const char* filename;
-		GLenum		type;
-		GLchar*     source;
-	} shaders[3] = {
-		{ vShaderFile, GL_VERTEX_SHADER, NULL },
-		{ fShaderFile, GL_FRAGMENT_SHADER, NULL},
-		{ gShaderFile, GL_GEOMETRY_SHADER, NULL}
-	};
-
-
-	GLuint program = glCreateProgram();
+	//source and log are scratch, released before returning
+	size_t mark = arenaMark(frameArena);
+	GLchar* source = readShaderSource( filename, frameArena );
 
-	int j = 0;
-
-	if(gShaderFile == NULL)
-	{
-		j = 2;
-	}
-	else
+	if( source == NULL )
 	{
-		j = 3;
+		std::cout << "Failed to read " << filename << std::endl;
+		exit(EXIT_FAILURE);
 	}
 
-	for(int i = 0; i < j; ++i)
-	{
-		Shader& s = shaders[i];
-
-		s.source = readShaderSource( s.filename );
-
-		if( shaders[i].source == NULL )
-		{
-			std::cout << "Failed to read " << s.filename << std::endl;
-			exit(EXIT_FAILURE);
-		}
+	GLuint shader = glCreateShader( type );
+	glShaderSource( shader, 1, (const GLchar**) &source, NULL);
+	glCompileShader( shader );
 
-		GLuint shader = glCreateShader( s.type );
-		glShaderSource( shader, 1, (const GLchar**) &s.source, NULL);
-		glCompileShader( shader );
+	GLint compiled;
 
-		GLint compiled;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled );
 
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled );
-
-		if ( !compiled)
-		{
-			std::cout << s.filename << "failed to compile:" << std::endl;
-			GLint logSize;
+	if ( !compiled)
+	{
+		std::cout << filename << "failed to compile:" << std::endl;
+		GLint logSize;
 
-			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize );
-			char* logMsg = new char [logSize];
-			glGetShaderInfoLog( shader, logSize, NULL, logMsg );
-			std::cout << logMsg << std::endl;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize );
+		char* logMsg = arenaArray<char>(frameArena, logSize);
+		glGetShaderInfoLog( shader, logSize, NULL, logMsg );
+		std::cout << logMsg << std::endl;
 
-			delete [] logMsg;
-			 exit (EXIT_FAILURE);
-		}
+		 exit (EXIT_FAILURE);
+	}
 
-		delete [] s.source;
+	arenaRelease(frameArena, mark);
 
-		glAttachShader(program, shader);
-	}
+	return shader;
+}
 
+//link program, exits with the log on failure
+static void linkProgram(GLuint program)
+{
 	glLinkProgram(program);
 
 	GLint linked;
@@ -98,15 +77,67 @@ GLuint InitShader(const char* vShaderFile, const char* fShaderFile, const char*
 		std::cout << "Shader program failed to link" << std::endl;
 		GLint logSize;
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logSize);
-		char* logMsg = new char[logSize];
+		char* logMsg = arenaArray<char>(frameArena, logSize);
 		glGetProgramInfoLog(program, logSize, NULL, logMsg);
 		std::cout << logMsg << std::endl;
-		delete [] logMsg;
 
 		exit( EXIT_FAILURE );
 	}
+}
+
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile,
+				  const char* tcShaderFile, const char* teShaderFile)
+{
+	struct Shader{
+		const char* filename;
+		GLenum		type;
+	} shaders[5] = {
+		{ vShaderFile, GL_VERTEX_SHADER },
+		{ fShaderFile, GL_FRAGMENT_SHADER },
+		{ gShaderFile, GL_GEOMETRY_SHADER },
+		{ tcShaderFile, GL_TESS_CONTROL_SHADER },
+		{ teShaderFile, GL_TESS_EVALUATION_SHADER }
+	};
+
+
+	GLuint program = glCreateProgram();
+
+	//the optional stages are skipped when NULL
+	for(int i = 0; i < 5; ++i)
+	{
+		Shader& s = shaders[i];
+
+		if (s.filename == NULL)
+			continue;
+
+		GLuint shader = compileShader(s.filename, s.type);
+
+		glAttachShader(program, shader);
+	}
+
+	linkProgram(program);
 
 	glUseProgram(program);
 
 	return program;
-}
\ No newline at end of file
+}
+
+GLuint InitComputeShader(const char* cShaderFile)
+{
+	GLuint program = glCreateProgram();
+
+	glAttachShader(program, compileShader(cShaderFile, GL_COMPUTE_SHADER));
+
+	linkProgram(program);
+
+	return program;
+}
+
+bool hasGLVersion(int major, int minor)
+{
+	GLint contextMajor = 0, contextMinor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+	glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+
+	return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
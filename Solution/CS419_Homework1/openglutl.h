@@ -1,11 +1,25 @@
 #ifndef __OPENGL_UTIL__
 #define __OPENGL_UTIL__
 
+#include <cstdlib>
+#include <cmath>
+
+//MATH_ONLY builds (tests, math benchmarks) use vec.h and mat.h without any GL headers
+//HEADLESS_ONLY builds render through EGL and do not need GLFW
+#ifdef MATH_ONLY
+typedef float GLfloat;
+typedef unsigned int GLuint;
+typedef void GLvoid;
+#else
 #define GLFW_INCLUDE_GLU
 #define GLEW_STATIC
 #include <GL/glew.h>
+#ifdef HEADLESS_ONLY
+typedef struct GLFWwindow GLFWwindow;
+#else
 #include <GLFW/glfw3.h>
-#include <cstdlib>
+#endif
+#endif
 
 
 #ifndef M_PI
@@ -13,7 +27,7 @@
 #endif
 
 // Define a helpful macro for handling offsets into buffer objects
-#define BUFFER_OFFSET( offset )   ((GLvoid*) (offset))
+#define BUFFER_OFFSET( offset )   ((GLvoid*) (size_t) (offset))
 
 //  Defined constant for when numbers are too small to be used in the
 //    denominator of a division operation.  This is only used if the
@@ -30,10 +44,18 @@ enum projection{ ORTHO, PERSPEC };
 #include "vec.h"
 #include "mat.h"
 
+#ifndef MATH_ONLY
 //provided  methods for  reading shaders, modified by myself to use C++ iostreams rather than C i/o
 
-static char* readShaderSource(const char* shaderFile);
+//the geometry and tessellation stages are optional
+GLuint InitShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile = NULL,
+				  const char* tcShaderFile = NULL, const char* teShaderFile = NULL);
+
+//same for a single compute shader
+GLuint InitComputeShader(const char* cShaderFile);
 
-GLuint InitShader(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile = NULL);
+//true if the current context is at least major.minor
+bool hasGLVersion(int major, int minor);
+#endif
 
 #endif //__OPENGL_UTIL__
\ No newline at end of file
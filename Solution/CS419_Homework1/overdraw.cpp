@@ -0,0 +1,84 @@
+#include <cstdio>
+#include "overdraw.h"
+
+//results are read this many frames later so the CPU rarely waits
+#define OVERDRAWFRAMES 4
+
+struct OverdrawQuery{
+	GLuint	query;
+	int		pixels;
+	bool	pending;
+};
+
+static OverdrawQuery queries[OVERDRAWFRAMES];
+static int current = 0;
+static bool enabled = false;
+
+static long long frames = 0;
+static double fragments = 0.0;
+static double fragmentsPerPixel = 0.0;
+
+static void collect(OverdrawQuery& query)
+{
+	if (!query.pending)
+		return;
+
+	GLuint64 samples = 0;
+	glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &samples);
+
+	++frames;
+	fragments += double(samples);
+	fragmentsPerPixel += double(samples) / query.pixels;
+	query.pending = false;
+}
+
+void initOverdraw()
+{
+	for (int i = 0; i < OVERDRAWFRAMES; ++i){
+		glGenQueries(1, &queries[i].query);
+		queries[i].pending = false;
+	}
+	current = 0;
+	frames = 0;
+	fragments = 0.0;
+	fragmentsPerPixel = 0.0;
+	enabled = true;
+}
+
+void overdrawBegin()
+{
+	if (!enabled)
+		return;
+
+	//this query was issued OVERDRAWFRAMES frames ago
+	collect(queries[current]);
+	glBeginQuery(GL_SAMPLES_PASSED, queries[current].query);
+}
+
+void overdrawEnd(int pixels)
+{
+	if (!enabled)
+		return;
+
+	glEndQuery(GL_SAMPLES_PASSED);
+	queries[current].pixels = pixels;
+	queries[current].pending = true;
+	current = (current + 1) % OVERDRAWFRAMES;
+}
+
+void shutdownOverdraw()
+{
+	if (!enabled)
+		return;
+
+	for (int i = 0; i < OVERDRAWFRAMES; ++i){
+		collect(queries[(current + i) % OVERDRAWFRAMES]);
+		glDeleteQueries(1, &queries[i].query);
+	}
+
+	if (frames)
+		printf("Shaded %.0f fragments per frame, %.3f per pixel, over %lld frames\n",
+			   fragments / frames, fragmentsPerPixel / frames, frames);
+
+	enabled = false;
+}
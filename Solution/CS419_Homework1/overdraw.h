@@ -0,0 +1,20 @@
+#ifndef __OVERDRAW__
+#define __OVERDRAW__
+
+#include "openglutl.h"
+
+//counts the fragments that pass the depth test in the shading pass with GL_SAMPLES_PASSED
+//with early depth testing that is the number of fragments actually shaded, so comparing
+//runs with and without the depth pre-pass shows whether it pays off
+
+//needs a current GL context
+void initOverdraw();
+
+//bracket the shading pass, pixels is the size of the render target
+void overdrawBegin();
+void overdrawEnd(int pixels);
+
+//print the averages and release the queries
+void shutdownOverdraw();
+
+#endif //__OVERDRAW__
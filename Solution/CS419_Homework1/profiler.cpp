@@ -0,0 +1,372 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "profiler.h"
+#include "arena.h"
+
+//frames of GPU queries in flight, results are read this many frames later
+#define QUERYFRAMES 4
+#define MAXGPUSCOPES 32
+
+bool profilerEnabled = false;
+
+struct ProfileTimer{
+	const char*			name;
+	bool				gpu;
+	bool				touched;
+	double				frameMs;
+	std::vector<double>	samples;
+};
+
+struct TraceEvent{
+	const char*	name;
+	int			thread;
+	double		start;
+	double		duration;
+};
+
+struct GpuFrame{
+	GLuint		queries[MAXGPUSCOPES * 2];
+	const char*	names[MAXGPUSCOPES];
+	int			count;
+	int			lastQuery;	//issued last, scopes nest so this is not always the last end query
+	bool		pending;
+};
+
+static std::mutex profileLock;
+static std::vector<ProfileTimer> timers;
+static std::vector<TraceEvent> events;
+static std::vector<std::thread::id> threads;
+
+static const char* traceFile = NULL;
+static bool gpuTiming = false;
+static std::chrono::high_resolution_clock::time_point startTime;
+static double frameStart = 0.0;
+
+static GpuFrame gpuFrames[QUERYFRAMES];
+static int gpuFrame = 0;
+//-1 marks a scope past MAXGPUSCOPES in a frame, its end has nothing to close
+//scopes nested deeper than the stack are only counted, so every end still pairs with its begin
+static int gpuStack[MAXGPUSCOPES];
+static int gpuDepth = 0;
+static int gpuTooDeep = 0;
+static int gpuDropped = 0;
+static GLint64 gpuBase = 0;
+static double gpuBaseCpu = 0.0;
+
+//trace thread 0 is reserved for the GPU timeline
+static int threadIndex()
+{
+	std::thread::id id = std::this_thread::get_id();
+	for (size_t i = 0; i < threads.size(); ++i){
+		if (threads[i] == id)
+			return int(i) + 1;
+	}
+	threads.push_back(id);
+	return int(threads.size());
+}
+
+static ProfileTimer& findTimer(const char* name, bool gpu)
+{
+	for (size_t i = 0; i < timers.size(); ++i){
+		if (timers[i].gpu == gpu && strcmp(timers[i].name, name) == 0)
+			return timers[i];
+	}
+
+	ProfileTimer timer;
+	timer.name = name;
+	timer.gpu = gpu;
+	timer.touched = false;
+	timer.frameMs = 0.0;
+	timer.samples.reserve(4096);
+	timers.push_back(timer);
+	return timers.back();
+}
+
+double profileNow()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void initProfiler(bool gpu, const char* tracePath)
+{
+	startTime = std::chrono::high_resolution_clock::now();
+	profilerEnabled = true;
+	gpuTiming = gpu;
+	traceFile = tracePath;
+
+	if (traceFile)
+		events.reserve(1 << 16);
+
+	if (gpuTiming){
+		for (int i = 0; i < QUERYFRAMES; ++i){
+			glGenQueries(MAXGPUSCOPES * 2, gpuFrames[i].queries);
+			gpuFrames[i].count = 0;
+			gpuFrames[i].lastQuery = 0;
+			gpuFrames[i].pending = false;
+		}
+
+		//line the GPU clock up with ours for the trace, this one query does sync
+		glGetInteger64v(GL_TIMESTAMP, &gpuBase);
+		gpuBaseCpu = profileNow();
+	}
+}
+
+void profileRecord(const char* name, double startUs, double endUs)
+{
+	//the sample and trace vectors grow for as long as the profiler runs
+	AllocExempt exempt;
+	std::lock_guard<std::mutex> lock(profileLock);
+
+	ProfileTimer& timer = findTimer(name, false);
+	timer.frameMs += (endUs - startUs) / 1000.0;
+	timer.touched = true;
+
+	if (traceFile){
+		TraceEvent e = { name, threadIndex(), startUs, endUs - startUs };
+		events.push_back(e);
+	}
+}
+
+//read back a finished frame of GPU queries, false if they are not ready yet
+static bool collectGpuFrame(GpuFrame& frame, bool wait)
+{
+	if (!frame.pending)
+		return true;
+
+	if (!wait && frame.count > 0){
+		GLint available = 0;
+		glGetQueryObjectiv(frame.queries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	AllocExempt exempt;
+	std::lock_guard<std::mutex> lock(profileLock);
+
+	for (int i = 0; i < frame.count; ++i){
+		GLuint64 begin, end;
+		glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+		ProfileTimer& timer = findTimer(frame.names[i], true);
+		timer.frameMs += (end - begin) / 1.0e6;
+		timer.touched = true;
+
+		if (traceFile){
+			TraceEvent e = { frame.names[i], 0, gpuBaseCpu + (GLint64(begin) - gpuBase) / 1000.0, (end - begin) / 1000.0 };
+			events.push_back(e);
+		}
+	}
+
+	//GPU results arrive a few frames late, so they close their own frame
+	for (size_t i = 0; i < timers.size(); ++i){
+		if (timers[i].gpu && timers[i].touched){
+			timers[i].samples.push_back(timers[i].frameMs);
+			timers[i].frameMs = 0.0;
+			timers[i].touched = false;
+		}
+	}
+
+	frame.pending = false;
+	frame.count = 0;
+	return true;
+}
+
+void profileFrameBegin()
+{
+	if (!profilerEnabled)
+		return;
+
+	frameStart = profileNow();
+
+	if (gpuTiming){
+		GpuFrame& frame = gpuFrames[gpuFrame];
+
+		//never stall on the GPU, a frame whose queries are still in flight is dropped
+		if (!collectGpuFrame(frame, false)){
+			frame.pending = false;
+			frame.count = 0;
+			++gpuDropped;
+		}
+		gpuDepth = 0;
+		gpuTooDeep = 0;
+	}
+}
+
+void profileFrameEnd()
+{
+	if (!profilerEnabled)
+		return;
+
+	profileRecord("frame", frameStart, profileNow());
+
+	{
+		AllocExempt exempt;
+		std::lock_guard<std::mutex> lock(profileLock);
+		for (size_t i = 0; i < timers.size(); ++i){
+			if (!timers[i].gpu && timers[i].touched){
+				timers[i].samples.push_back(timers[i].frameMs);
+				timers[i].frameMs = 0.0;
+				timers[i].touched = false;
+			}
+		}
+	}
+
+	if (gpuTiming){
+		gpuFrames[gpuFrame].pending = gpuFrames[gpuFrame].count > 0;
+		gpuFrame = (gpuFrame + 1) % QUERYFRAMES;
+	}
+}
+
+void profileGpuBegin(const char* name)
+{
+	if (!profilerEnabled || !gpuTiming)
+		return;
+
+	GpuFrame& frame = gpuFrames[gpuFrame];
+	if (gpuDepth >= MAXGPUSCOPES){
+		++gpuTooDeep;
+		return;
+	}
+	if (frame.count >= MAXGPUSCOPES){
+		gpuStack[gpuDepth++] = -1;
+		return;
+	}
+
+	//timestamps nest where GL_TIME_ELAPSED queries cannot
+	int index = frame.count++;
+	frame.names[index] = name;
+	glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+	gpuStack[gpuDepth++] = index;
+}
+
+void profileGpuEnd()
+{
+	if (!profilerEnabled || !gpuTiming)
+		return;
+	if (gpuTooDeep > 0){
+		--gpuTooDeep;
+		return;
+	}
+	if (gpuDepth == 0)
+		return;
+
+	GpuFrame& frame = gpuFrames[gpuFrame];
+	int index = gpuStack[--gpuDepth];
+	if (index < 0)
+		return;
+	glQueryCounter(frame.queries[index * 2 + 1], GL_TIMESTAMP);
+	frame.lastQuery = index * 2 + 1;
+}
+
+static void computeStats(const std::vector<double>& samples, ProfileStats& stats)
+{
+	std::vector<double> sorted(samples);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); ++i)
+		total += sorted[i];
+
+	stats.frames = int(sorted.size());
+	stats.minMs = sorted.front();
+	stats.avgMs = total / sorted.size();
+	stats.p99Ms = sorted[std::min(sorted.size() - 1, size_t(sorted.size() * 0.99))];
+}
+
+bool profileStats(const char* name, bool gpu, ProfileStats& stats)
+{
+	std::lock_guard<std::mutex> lock(profileLock);
+
+	for (size_t i = 0; i < timers.size(); ++i){
+		if (timers[i].gpu == gpu && strcmp(timers[i].name, name) == 0 && !timers[i].samples.empty()){
+			computeStats(timers[i].samples, stats);
+			return true;
+		}
+	}
+	return false;
+}
+
+void profileReset()
+{
+	std::lock_guard<std::mutex> lock(profileLock);
+
+	for (size_t i = 0; i < timers.size(); ++i){
+		timers[i].samples.clear();
+		timers[i].frameMs = 0.0;
+		timers[i].touched = false;
+	}
+	events.clear();
+	gpuDropped = 0;
+}
+
+static void writeTrace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file){
+		printf("Failed to open %s\n", path);
+		return;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+	for (size_t i = 0; i < threads.size(); ++i)
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CPU %d\"}}", int(i) + 1, int(i));
+
+	for (size_t i = 0; i < events.size(); ++i){
+		const TraceEvent& e = events[i];
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				e.name, e.thread, e.start, e.duration);
+	}
+	fprintf(file, "\n]}\n");
+
+	fclose(file);
+	printf("Wrote trace to %s\n", path);
+}
+
+void profileFlush()
+{
+	if (!profilerEnabled || !gpuTiming)
+		return;
+
+	glFinish();
+	for (int i = 1; i <= QUERYFRAMES; ++i)
+		collectGpuFrame(gpuFrames[(gpuFrame + i) % QUERYFRAMES], true);
+}
+
+void shutdownProfiler()
+{
+	if (!profilerEnabled)
+		return;
+
+	//the queries still in flight are worth waiting for at this point
+	profileFlush();
+
+	printf("%-16s %8s %10s %10s %10s\n", "scope", "frames", "min ms", "avg ms", "p99 ms");
+	for (size_t i = 0; i < timers.size(); ++i){
+		if (timers[i].samples.empty())
+			continue;
+
+		ProfileStats stats;
+		computeStats(timers[i].samples, stats);
+		printf("%-12s %-3s %8d %10.3f %10.3f %10.3f\n", timers[i].name, timers[i].gpu ? "gpu" : "cpu",
+			   stats.frames, stats.minMs, stats.avgMs, stats.p99Ms);
+	}
+	if (gpuDropped)
+		printf("%d frames of GPU timings were not ready in time and were dropped\n", gpuDropped);
+
+	if (traceFile)
+		writeTrace(traceFile);
+
+	if (gpuTiming){
+		for (int i = 0; i < QUERYFRAMES; ++i)
+			glDeleteQueries(MAXGPUSCOPES * 2, gpuFrames[i].queries);
+	}
+
+	profilerEnabled = false;
+}
@@ -0,0 +1,65 @@
+#ifndef __PROFILER__
+#define __PROFILER__
+
+#include "openglutl.h"
+
+//lightweight frame profiler
+//CPU time is measured with named scopes, GPU time with GL_TIMESTAMP query pairs
+//that are read back several frames later so the CPU never waits on the GPU
+//per-frame times are reported as min/avg/p99, optionally with a Chrome trace
+
+extern bool profilerEnabled;
+
+//enable the profiler, gpu timing needs a current GL context
+//tracePath may be NULL, otherwise a chrome://tracing JSON file is written on shutdown
+void initProfiler(bool gpu, const char* tracePath);
+
+//mark frame boundaries, every scope between them counts toward that frame
+void profileFrameBegin();
+void profileFrameEnd();
+
+//GPU scopes, may nest but only on the thread that owns the GL context
+void profileGpuBegin(const char* name);
+void profileGpuEnd();
+
+//CPU time in microseconds since the profiler started
+double profileNow();
+
+//record a finished CPU scope, name must be a string literal
+void profileRecord(const char* name, double startUs, double endUs);
+
+//print the report, write the trace and release the queries
+void shutdownProfiler();
+
+//timing of the profiled frames, for callers that report their own results
+struct ProfileStats{
+	int		frames;
+	double	minMs;
+	double	avgMs;
+	double	p99Ms;
+};
+bool profileStats(const char* name, bool gpu, ProfileStats& stats);
+
+//wait for the GPU and collect every query still in flight
+void profileFlush();
+
+//forget all samples, e.g. after warm up frames
+void profileReset();
+
+//times a CPU scope from construction to destruction
+struct ProfileScope{
+	const char* name;
+	double		start;
+
+	ProfileScope(const char* name) : name(name)
+	{ start = profilerEnabled ? profileNow() : 0.0; }
+
+	~ProfileScope()
+	{ if (profilerEnabled) profileRecord(name, start, profileNow()); }
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+
+#endif //__PROFILER__
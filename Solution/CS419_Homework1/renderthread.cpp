@@ -0,0 +1,100 @@
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "renderthread.h"
+
+static FrameSnapshot snapshots[2];
+static int front = 0;
+static bool fresh = false;
+static bool stopping = false;
+
+static std::thread renderer;
+static std::mutex snapshotLock;
+static std::condition_variable snapshotChanged;
+
+static std::mutex latchLock;
+static vec4 latched;
+static int latchCount = 0;
+
+FrameSnapshot& snapshotBack()
+{
+	//only the simulation thread swaps, so the back index is stable without the lock
+	return snapshots[1 - front];
+}
+
+void publishSnapshot()
+{
+	std::unique_lock<std::mutex> lock(snapshotLock);
+	while (fresh && !stopping)
+		snapshotChanged.wait(lock);
+
+	front = 1 - front;
+	fresh = true;
+	snapshotChanged.notify_all();
+}
+
+bool waitSnapshotTaken(double seconds)
+{
+	std::unique_lock<std::mutex> lock(snapshotLock);
+	if (fresh && !stopping)
+		snapshotChanged.wait_for(lock, std::chrono::duration<double>(seconds));
+	return !fresh || stopping;
+}
+
+bool takeSnapshot(FrameSnapshot& snapshot)
+{
+	std::unique_lock<std::mutex> lock(snapshotLock);
+	while (!fresh && !stopping)
+		snapshotChanged.wait(lock);
+
+	if (stopping)
+		return false;
+
+	//copying out keeps the lock short, the front slot is free again right away
+	snapshot = snapshots[front];
+	fresh = false;
+	snapshotChanged.notify_all();
+	return true;
+}
+
+void latchRotation(const vec4& rot)
+{
+	std::lock_guard<std::mutex> lock(latchLock);
+	latched = rot;
+	++latchCount;
+}
+
+int latchSequence()
+{
+	std::lock_guard<std::mutex> lock(latchLock);
+	return latchCount;
+}
+
+bool latchedRotation(int after, vec4& rot)
+{
+	std::lock_guard<std::mutex> lock(latchLock);
+	if (latchCount <= after)
+		return false;
+
+	rot = latched;
+	return true;
+}
+
+void startRenderThread(void (*loop)())
+{
+	front = 0;
+	fresh = false;
+	stopping = false;
+	renderer = std::thread(loop);
+}
+
+void stopRenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(snapshotLock);
+		stopping = true;
+		snapshotChanged.notify_all();
+	}
+	renderer.join();
+}
@@ -0,0 +1,49 @@
+#ifndef __RENDERTHREAD__
+#define __RENDERTHREAD__
+
+#include "openglutl.h"
+
+//hand off between the simulation thread and a render thread that owns the GL context
+//the simulation fills the back snapshot while the renderer draws the front one,
+//publishing swaps them so the next frame is prepared while the GPU draws this one
+
+//everything a frame needs from the simulation
+struct FrameSnapshot{
+	vec4	rot;
+	vec4	light;		//world space position of the point light
+	int		meshM;		//sphere resolution, regenerated when it changes
+	int		meshN;
+	mat4	modelView;
+	mat4	projection;
+	int		width;
+	int		height;
+	int		latch;		//latchSequence() when the snapshot was taken
+};
+
+//the snapshot the simulation thread may write, valid until the next publish
+FrameSnapshot& snapshotBack();
+
+//hand the back snapshot to the renderer, waits while the previous one is still untaken
+//so the simulation never runs more than a frame ahead
+void publishSnapshot();
+
+//true once the renderer has taken the last published snapshot
+//waits up to seconds for it, so input can still be handled while the renderer is busy
+bool waitSnapshotTaken(double seconds);
+
+//copy out the newest snapshot, waits for one, false once the render thread should stop
+bool takeSnapshot(FrameSnapshot& snapshot);
+
+//late latching, input that arrives after a snapshot was taken still reaches its frame
+//the input thread stores its newest rotation, the renderer reads it right before drawing
+void latchRotation(const vec4& rot);
+int latchSequence();
+
+//the latched rotation if it is newer than sequence after, otherwise rot is left alone
+bool latchedRotation(int after, vec4& rot);
+
+//run loop on its own thread until stopRenderThread, loop should call takeSnapshot
+void startRenderThread(void (*loop)());
+void stopRenderThread();
+
+#endif //__RENDERTHREAD__
@@ -0,0 +1,151 @@
+#include <cstdio>
+#include "shadow.h"
+
+//near plane of the cube faces, the far plane is ShadowFar
+#define SHADOWNEAR 0.05f
+
+static GLuint shadowProgram = 0;
+static GLint ShadowMatrices;
+static GLint ShadowLight;
+static GLint ShadowRot;
+
+static GLuint cubeMap = 0;
+static GLuint cubeBuffer = 0;
+static int mapSize = 0;
+static float mapFar = 0.0f;
+
+//state the map was last drawn with
+static bool valid = false;
+static vec4 mapLight;
+static vec4 mapRot;
+static int mapVersion = 0;
+
+//restored by endShadowPass
+static GLint savedBuffer = 0;
+static GLint savedViewport[4];
+static GLint savedProgram = 0;
+
+static int checks = 0;
+static int renders = 0;
+
+GLuint initShadows(int size, float farPlane)
+{
+	mapSize = size;
+	mapFar = farPlane;
+
+	glGenTextures(1, &cubeMap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+	for (int face = 0; face < 6; ++face)
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+					 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+	//hardware comparison, linear filtering gives 2x2 percentage closer filtering
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	GLint target;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+	//attaching the whole cube makes the framebuffer layered
+	glGenFramebuffers(1, &cubeBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, cubeBuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubeMap, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		printf("Shadow framebuffer is incomplete\n");
+		exit(EXIT_FAILURE);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+
+	shadowProgram = InitShader("vshaderShadow.glsl", "fshaderShadow.glsl", "gshaderShadow.glsl");
+	ShadowMatrices = glGetUniformLocation(shadowProgram, "ShadowMatrices");
+	ShadowLight = glGetUniformLocation(shadowProgram, "LightPosition");
+	ShadowRot = glGetUniformLocation(shadowProgram, "Rot");
+	glUseProgram(shadowProgram);
+	glUniform1f(glGetUniformLocation(shadowProgram, "ShadowFar"), farPlane);
+
+	valid = false;
+	checks = renders = 0;
+
+	return shadowProgram;
+}
+
+static bool same(const vec4& a, const vec4& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+bool shadowsStale(const vec4& light, const vec4& rot, int casterVersion)
+{
+	++checks;
+	return !valid || !same(light, mapLight) || !same(rot, mapRot) || casterVersion != mapVersion;
+}
+
+void beginShadowPass(const vec4& light, const vec4& rot, int casterVersion)
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedBuffer);
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &savedProgram);
+
+	//the cube faces, looking down each axis with the up vectors of the cube map layout
+	static const vec4 axes[6] = { vec4(1, 0, 0, 0), vec4(-1, 0, 0, 0), vec4(0, 1, 0, 0),
+								  vec4(0, -1, 0, 0), vec4(0, 0, 1, 0), vec4(0, 0, -1, 0) };
+	static const vec4 ups[6] = { vec4(0, -1, 0, 0), vec4(0, -1, 0, 0), vec4(0, 0, 1, 0),
+								 vec4(0, 0, -1, 0), vec4(0, -1, 0, 0), vec4(0, -1, 0, 0) };
+
+	vec4 eye(light.x, light.y, light.z, 1.0);
+	mat4 projection = Perspective(90.0, 1.0, SHADOWNEAR, mapFar);
+	mat4 faces[6];
+	for (int face = 0; face < 6; ++face)
+		faces[face] = projection * LookAt(eye, eye + axes[face], ups[face]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, cubeBuffer);
+	glViewport(0, 0, mapSize, mapSize);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(shadowProgram);
+	glUniformMatrix4fv(ShadowMatrices, 6, GL_TRUE, faces[0][0]);
+	glUniform4fv(ShadowLight, 1, eye);
+	glUniform4fv(ShadowRot, 1, rot);
+
+	valid = true;
+	mapLight = light;
+	mapRot = rot;
+	mapVersion = casterVersion;
+	++renders;
+}
+
+void endShadowPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, savedBuffer);
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+	glUseProgram(savedProgram);
+}
+
+void bindShadowMap(GLenum unit)
+{
+	glActiveTexture(unit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void shutdownShadows()
+{
+	if (!shadowProgram)
+		return;
+
+	printf("Shadow map drawn %d times in %d frames\n", renders, checks);
+
+	glDeleteFramebuffers(1, &cubeBuffer);
+	glDeleteTextures(1, &cubeMap);
+	glDeleteProgram(shadowProgram);
+	shadowProgram = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef __SHADOW__
+#define __SHADOW__
+
+#include "openglutl.h"
+
+//omnidirectional shadows for the point light
+//the six faces of a depth cube map are drawn in one pass, a geometry shader sends
+//each triangle to the faces it touches through gl_Layer
+//the map is cached, it is only drawn again when the light or a caster moved,
+//so a still scene costs nothing per frame beyond the lookup
+
+//create the cube map and the caster program (vshaderShadow, gshaderShadow, fshaderShadow),
+//returns the program so the caller can bind its vertex arrays, needs OpenGL 3.2
+GLuint initShadows(int size, float farPlane);
+
+//true if the map is out of date for this light, caster rotation and caster version,
+//casterVersion should change whenever the caster meshes or placements change
+bool shadowsStale(const vec4& light, const vec4& rot, int casterVersion);
+
+//bind the map as the render target and the caster program, draw the casters after
+//this with the vertex arrays built for the program, then call endShadowPass
+void beginShadowPass(const vec4& light, const vec4& rot, int casterVersion);
+void endShadowPass();
+
+//bind the map for the lookup in the forward shaders
+void bindShadowMap(GLenum unit);
+
+//print how often the map was drawn and release it
+void shutdownShadows();
+
+#endif //__SHADOW__
@@ -0,0 +1,318 @@
+#include <cmath>
+#include "simdmath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE
+#endif
+
+//polynomials and range reduction after Cephes sinf, atanf and asinf
+
+#define PIF			3.14159265358979f
+#define PIO2F		1.57079632679490f
+#define PIO4F		0.785398163397448f
+#define TWOOPIF		0.636619772367581f
+
+//pi / 2 split in three so j * DP1 and j * DP2 are exact
+#define DP1			1.5703125f
+#define DP2			4.837512969970703125e-4f
+#define DP3			7.54978995489188216e-8f
+
+#define SIN0		-1.6666654611e-1f
+#define SIN1		8.3321608736e-3f
+#define SIN2		-1.9515295891e-4f
+
+#define COS0		4.166664568298827e-2f
+#define COS1		-1.388731625493765e-3f
+#define COS2		2.443315711809948e-5f
+
+#define TAN3PIO8F	2.414213562373095f
+#define TANPIO8F	0.4142135623730950f
+
+#define ATAN0		8.05374449538e-2f
+#define ATAN1		-1.38776856032e-1f
+#define ATAN2		1.99777106478e-1f
+#define ATAN3		-3.33329491539e-1f
+
+#define ASIN0		4.2163199048e-2f
+#define ASIN1		2.4181311049e-2f
+#define ASIN2		4.5470025998e-2f
+#define ASIN3		7.4953002686e-2f
+#define ASIN4		1.6666752422e-1f
+
+#pragma region scalar
+
+//x = j * pi / 2 + r with |r| <= pi / 4, the sine and cosine of r
+static inline int reduce(float x, float& sr, float& cr)
+{
+	float jf = std::floor(x * TWOOPIF + 0.5f);
+	float r = ((x - jf * DP1) - jf * DP2) - jf * DP3;
+	float z = r * r;
+
+	sr = r + r * z * (SIN0 + z * (SIN1 + z * SIN2));
+	cr = 1.0f - 0.5f * z + z * z * (COS0 + z * (COS1 + z * COS2));
+	return int(jf);
+}
+
+float fastSin(float x)
+{
+	float sr, cr;
+	int q = reduce(x, sr, cr) & 3;
+	float v = (q & 1) ? cr : sr;
+	return (q & 2) ? -v : v;
+}
+
+float fastCos(float x)
+{
+	float sr, cr;
+	int q = reduce(x, sr, cr) & 3;
+	float v = (q & 1) ? sr : cr;
+	return ((q + 1) & 2) ? -v : v;
+}
+
+void fastSincos(float x, float& s, float& c)
+{
+	float sr, cr;
+	int q = reduce(x, sr, cr) & 3;
+	s = (q & 1) ? cr : sr;
+	c = (q & 1) ? sr : cr;
+	if (q & 2)
+		s = -s;
+	if ((q + 1) & 2)
+		c = -c;
+}
+
+static inline float fastAtan(float x)
+{
+	float a = std::fabs(x);
+	float y0 = 0.0f;
+
+	if (a > TAN3PIO8F){
+		y0 = PIO2F;
+		a = -1.0f / a;
+	}
+	else if (a > TANPIO8F){
+		y0 = PIO4F;
+		a = (a - 1.0f) / (a + 1.0f);
+	}
+
+	float z = a * a;
+	float y = (((ATAN0 * z + ATAN1) * z + ATAN2) * z + ATAN3) * z * a + a + y0;
+	return std::signbit(x) ? -y : y;
+}
+
+float fastAtan2(float y, float x)
+{
+	//0 / 0 would be NaN, atan(y) keeps the sign of a zero y
+	float t = fastAtan((x == 0.0f && y == 0.0f) ? y : y / x);
+
+	//left half plane, the sign bit of x so -0 counts as left like atan2
+	if (std::signbit(x))
+		t += std::signbit(y) ? -PIF : PIF;
+	return t;
+}
+
+float fastAsin(float x)
+{
+	float a = std::fabs(x);
+	bool big = a > 0.5f;
+	float z = big ? 0.5f * (1.0f - a) : a * a;
+	float r = big ? std::sqrt(z) : a;
+
+	float y = ((((ASIN0 * z + ASIN1) * z + ASIN2) * z + ASIN3) * z + ASIN4) * z * r + r;
+	if (big)
+		y = PIO2F - 2.0f * y;
+	return std::signbit(x) ? -y : y;
+}
+
+//scalar
+#pragma endregion
+
+#pragma region sse
+
+#ifdef SIMD_SSE
+
+static inline __m128 blend(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 signMask()
+{
+	return _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+}
+
+static inline void sincos4(__m128 x, __m128& s, __m128& c)
+{
+	//cvtps rounds to nearest like the floor(+ 0.5) of reduce
+	__m128i j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWOOPIF)));
+	__m128 jf = _mm_cvtepi32_ps(j);
+
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(jf, _mm_set1_ps(DP1)));
+	r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(DP2)));
+	r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(DP3)));
+	__m128 z = _mm_mul_ps(r, r);
+
+	__m128 sp = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(SIN2)), _mm_set1_ps(SIN1));
+	sp = _mm_add_ps(_mm_mul_ps(z, sp), _mm_set1_ps(SIN0));
+	sp = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sp));
+
+	__m128 cp = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(COS2)), _mm_set1_ps(COS1));
+	cp = _mm_add_ps(_mm_mul_ps(z, cp), _mm_set1_ps(COS0));
+	cp = _mm_mul_ps(_mm_mul_ps(z, z), cp);
+	cp = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)), cp);
+
+	//odd quadrants swap the two, bit 1 of q (of q + 1 for cos) flips the sign
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 sSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+	__m128 cSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+	s = _mm_xor_ps(blend(swap, cp, sp), sSign);
+	c = _mm_xor_ps(blend(swap, sp, cp), cSign);
+}
+
+static inline __m128 atan4(__m128 x)
+{
+	__m128 sign = _mm_and_ps(x, signMask());
+	__m128 a = _mm_andnot_ps(signMask(), x);
+
+	__m128 big = _mm_cmpgt_ps(a, _mm_set1_ps(TAN3PIO8F));
+	__m128 mid = _mm_andnot_ps(big, _mm_cmpgt_ps(a, _mm_set1_ps(TANPIO8F)));
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 xBig = _mm_div_ps(_mm_set1_ps(-1.0f), a);
+	__m128 xMid = _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one));
+	a = blend(big, xBig, blend(mid, xMid, a));
+	__m128 y0 = _mm_or_ps(_mm_and_ps(big, _mm_set1_ps(PIO2F)), _mm_and_ps(mid, _mm_set1_ps(PIO4F)));
+
+	__m128 z = _mm_mul_ps(a, a);
+	__m128 y = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(ATAN0)), _mm_set1_ps(ATAN1));
+	y = _mm_add_ps(_mm_mul_ps(z, y), _mm_set1_ps(ATAN2));
+	y = _mm_add_ps(_mm_mul_ps(z, y), _mm_set1_ps(ATAN3));
+	y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(z, a), y), a), y0);
+
+	return _mm_xor_ps(y, sign);
+}
+
+static inline __m128 atan24(__m128 y, __m128 x)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 bothZero = _mm_and_ps(_mm_cmpeq_ps(x, zero), _mm_cmpeq_ps(y, zero));
+	__m128 t = atan4(blend(bothZero, y, _mm_div_ps(y, x)));
+
+	//+-pi taking the sign of y, added where the sign bit of x is set
+	__m128 left = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x), 31));
+	__m128 pi = _mm_or_ps(_mm_set1_ps(PIF), _mm_and_ps(y, signMask()));
+	return _mm_add_ps(t, _mm_and_ps(left, pi));
+}
+
+static inline __m128 asin4(__m128 x)
+{
+	__m128 sign = _mm_and_ps(x, signMask());
+	__m128 a = _mm_andnot_ps(signMask(), x);
+
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 big = _mm_cmpgt_ps(a, half);
+	__m128 zBig = _mm_mul_ps(half, _mm_sub_ps(_mm_set1_ps(1.0f), a));
+	__m128 z = blend(big, zBig, _mm_mul_ps(a, a));
+	__m128 r = blend(big, _mm_sqrt_ps(zBig), a);
+
+	__m128 y = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(ASIN0)), _mm_set1_ps(ASIN1));
+	y = _mm_add_ps(_mm_mul_ps(z, y), _mm_set1_ps(ASIN2));
+	y = _mm_add_ps(_mm_mul_ps(z, y), _mm_set1_ps(ASIN3));
+	y = _mm_add_ps(_mm_mul_ps(z, y), _mm_set1_ps(ASIN4));
+	y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(z, r), y), r);
+
+	y = blend(big, _mm_sub_ps(_mm_set1_ps(PIO2F), _mm_add_ps(y, y)), y);
+	return _mm_xor_ps(y, sign);
+}
+
+#endif
+
+//sse
+#pragma endregion
+
+#pragma region batches
+
+void sinBatch(const float* x, float* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_SSE
+	for (; i + 4 <= count; i += 4){
+		__m128 s, c;
+		sincos4(_mm_loadu_ps(x + i), s, c);
+		_mm_storeu_ps(out + i, s);
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = fastSin(x[i]);
+}
+
+void cosBatch(const float* x, float* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_SSE
+	for (; i + 4 <= count; i += 4){
+		__m128 s, c;
+		sincos4(_mm_loadu_ps(x + i), s, c);
+		_mm_storeu_ps(out + i, c);
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = fastCos(x[i]);
+}
+
+void sincosBatch(const float* x, float* s, float* c, int count)
+{
+	int i = 0;
+#ifdef SIMD_SSE
+	for (; i + 4 <= count; i += 4){
+		__m128 sv, cv;
+		sincos4(_mm_loadu_ps(x + i), sv, cv);
+		_mm_storeu_ps(s + i, sv);
+		_mm_storeu_ps(c + i, cv);
+	}
+#endif
+	for (; i < count; ++i)
+		fastSincos(x[i], s[i], c[i]);
+}
+
+void atan2Batch(const float* y, const float* x, float* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_SSE
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, atan24(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+#endif
+	for (; i < count; ++i)
+		out[i] = fastAtan2(y[i], x[i]);
+}
+
+void asinBatch(const float* x, float* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_SSE
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, asin4(_mm_loadu_ps(x + i)));
+#endif
+	for (; i < count; ++i)
+		out[i] = fastAsin(x[i]);
+}
+
+void sincosSteps(double start, double step, int count, float* s, float* c)
+{
+	double ds = std::sin(step), dc = std::cos(step);
+	double sv = std::sin(start), cv = std::cos(start);
+
+	for (int i = 0; i < count; ++i){
+		s[i] = float(sv);
+		c[i] = float(cv);
+
+		double next = sv * dc + cv * ds;
+		cv = cv * dc - sv * ds;
+		sv = next;
+	}
+}
+
+//batches
+#pragma endregion
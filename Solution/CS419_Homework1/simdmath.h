@@ -0,0 +1,32 @@
+#ifndef __SIMD_MATH__
+#define __SIMD_MATH__
+
+//single precision sin, cos, atan2 and asin for batches of floats
+//the batch functions run four lanes at a time with SSE where available and fall back to
+//the same polynomials one value at a time, the scalar functions are those polynomials
+//
+//measured against libm in double rounded to float (tests.cpp checks these bounds):
+//	sin, cos		2 ulp for |x| <= 8192, past that the range reduction loses bits
+//	atan2			3 ulp, NaN when both arguments are infinite
+//	asin			2 ulp, NaN outside [-1, 1] like asin
+//where sin or cos is below 1e-3 the error is measured absolutely instead, under 1e-9
+
+float fastSin(float x);
+float fastCos(float x);
+void fastSincos(float x, float& s, float& c);
+float fastAtan2(float y, float x);
+float fastAsin(float x);
+
+//out[i] = f(x[i]) for count values, out may alias the input
+void sinBatch(const float* x, float* out, int count);
+void cosBatch(const float* x, float* out, int count);
+void sincosBatch(const float* x, float* s, float* c, int count);
+void atan2Batch(const float* y, const float* x, float* out, int count);
+void asinBatch(const float* x, float* out, int count);
+
+//sin and cos of start + i * step for count steps of a regular grid
+//rotates by step in double precision instead of evaluating each angle,
+//the drift is around count * 1e-16 so it stays below float precision for any mesh size
+void sincosSteps(double start, double step, int count, float* s, float* c);
+
+#endif //__SIMD_MATH__
@@ -0,0 +1,527 @@
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "softraster.h"
+#include "jobs.h"
+#include "SOIL.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFT_SSE
+#endif
+
+#define TILESIZE 64
+
+//vertex shader outputs
+struct SoftVertex{
+	vec4	clip;
+	vec3	N;
+	vec3	E;
+	vec3	L;
+	vec2	tex;
+};
+
+//a triangle ready to rasterize, vertices index the verts of the batch that set it up
+struct SoftTriangle{
+	int		v[3];
+	float	x[3];
+	float	y[3];
+	float	z[3];
+	float	invW[3];
+	int		minX, minY, maxX, maxY;
+};
+
+//what one worker produced in the geometry stage
+struct SoftBatch{
+	std::vector<SoftVertex>			verts;
+	std::vector<SoftTriangle>		tris;
+	std::vector<std::vector<int> >	bins;
+};
+
+struct SoftTarget{
+	int				width;
+	int				height;
+	int				tilesX;
+	int				tilesY;
+	unsigned char*	rgba;
+};
+
+bool loadSoftTexture(const char* path, SoftTexture& texture)
+{
+	int channels;
+	unsigned char* data = SOIL_load_image(path, &texture.width, &texture.height, &channels, SOIL_LOAD_RGB);
+	if (!data){
+		printf("SOIL loading error: '%s'\n", SOIL_last_result());
+		return false;
+	}
+
+	texture.rgb.assign(data, data + texture.width * texture.height * 3);
+	SOIL_free_image_data(data);
+
+	//SOIL_FLAG_NTSC_SAFE_RGB squeezes every channel into [16, 235]
+	const float lo = 16.0f - 0.499f;
+	const float hi = 235.0f + 0.499f;
+	for (size_t i = 0; i < texture.rgb.size(); ++i)
+		texture.rgb[i] = (unsigned char)((hi - lo) * texture.rgb[i] / 255.0f + lo);
+
+	return true;
+}
+
+#pragma region vertex stage
+
+//object to eye space for one instance, the q_rot of the vertex shader as a matrix,
+//then the placement and the view, which LookAt keeps affine
+static mat3x4 instanceTransform(const SoftScene& scene, const vec4& offset)
+{
+	vec4 q = normalize(scene.rot);
+	GLfloat w = q.x, x = q.y, y = q.z, z = q.w;
+	mat3x4 rotation(vec4(1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y), 0),
+					vec4(2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x), 0),
+					vec4(2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y), 0));
+
+	mat3x4 place(vec4(offset.w, 0, 0, offset.x), vec4(0, offset.w, 0, offset.y), vec4(0, 0, offset.w, offset.z));
+
+	return mat3x4(scene.modelView) * place * rotation;
+}
+
+static void shadeVertex(const SoftScene& scene, const mat3x4& instanceView, const vec3& light,
+						int vertex, SoftVertex& out)
+{
+	//the normal picks up the instance scale, it is normalized per fragment
+	vec4 e = instanceView * scene.points[vertex];
+	out.N = transformVector(instanceView, scene.normals[vertex]);
+	out.E = -vec3(e.x, e.y, e.z);
+	out.L = light;
+	if (scene.lightPosition.w != 0.0)
+		out.L = out.L + out.E;
+
+	out.tex = scene.texCoords[vertex];
+	out.clip = scene.projection * e;
+}
+
+static SoftVertex lerpVertex(const SoftVertex& a, const SoftVertex& b, float t)
+{
+	SoftVertex r;
+	r.clip = a.clip + t * (b.clip - a.clip);
+	r.N = a.N + t * (b.N - a.N);
+	r.E = a.E + t * (b.E - a.E);
+	r.L = a.L + t * (b.L - a.L);
+	r.tex = a.tex + t * (b.tex - a.tex);
+	return r;
+}
+
+//window coordinates, bounds and bins for a triangle whose vertices are in batch.verts
+static void setupTriangle(SoftBatch& batch, const SoftTarget& target, int v0, int v1, int v2)
+{
+	SoftTriangle tri;
+	tri.v[0] = v0;
+	tri.v[1] = v1;
+	tri.v[2] = v2;
+
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+	for (int i = 0; i < 3; ++i){
+		const vec4& c = batch.verts[tri.v[i]].clip;
+		tri.invW[i] = 1.0f / c.w;
+		tri.x[i] = (c.x * tri.invW[i] * 0.5f + 0.5f) * target.width;
+		tri.y[i] = (c.y * tri.invW[i] * 0.5f + 0.5f) * target.height;
+		tri.z[i] = c.z * tri.invW[i];
+
+		minX = std::min(minX, tri.x[i]);
+		maxX = std::max(maxX, tri.x[i]);
+		minY = std::min(minY, tri.y[i]);
+		maxY = std::max(maxY, tri.y[i]);
+	}
+
+	//pixel centers sit at +0.5
+	tri.minX = std::max(0, int(std::ceil(minX - 0.5f)));
+	tri.minY = std::max(0, int(std::ceil(minY - 0.5f)));
+	tri.maxX = std::min(target.width - 1, int(std::floor(maxX - 0.5f)));
+	tri.maxY = std::min(target.height - 1, int(std::floor(maxY - 0.5f)));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	//degenerate triangles cover nothing
+	float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+	if (area == 0.0f)
+		return;
+
+	int index = int(batch.tris.size());
+	batch.tris.push_back(tri);
+
+	for (int ty = tri.minY / TILESIZE; ty <= tri.maxY / TILESIZE; ++ty){
+		for (int tx = tri.minX / TILESIZE; tx <= tri.maxX / TILESIZE; ++tx)
+			batch.bins[ty * target.tilesX + tx].push_back(index);
+	}
+}
+
+//clip against the near plane z = -w, the other planes are handled by the bounds and depth test
+static void clipTriangle(SoftBatch& batch, const SoftTarget& target, int first)
+{
+	const SoftVertex* in[3] = { &batch.verts[first], &batch.verts[first + 1], &batch.verts[first + 2] };
+	float d[3];
+	int inside = 0;
+	for (int i = 0; i < 3; ++i){
+		d[i] = in[i]->clip.z + in[i]->clip.w;
+		if (d[i] >= 0.0f)
+			++inside;
+	}
+
+	if (inside == 3){
+		setupTriangle(batch, target, first, first + 1, first + 2);
+		return;
+	}
+	if (inside == 0)
+		return;
+
+	//walk the edges keeping the inside part, at most four vertices come out
+	SoftVertex out[4];
+	int count = 0;
+	for (int i = 0; i < 3; ++i){
+		int j = (i + 1) % 3;
+		if (d[i] >= 0.0f)
+			out[count++] = *in[i];
+		if ((d[i] >= 0.0f) != (d[j] >= 0.0f))
+			out[count++] = lerpVertex(*in[i], *in[j], d[i] / (d[i] - d[j]));
+	}
+
+	int base = int(batch.verts.size());
+	for (int i = 0; i < count; ++i)
+		batch.verts.push_back(out[i]);
+
+	for (int i = 2; i < count; ++i)
+		setupTriangle(batch, target, base, base + i - 1, base + i);
+}
+
+//shade the vertices of triangles [begin, end) of the instanced draw and bin them
+static void geometryStage(const SoftScene& scene, const SoftTarget& target, SoftBatch& batch,
+						  long long begin, long long end)
+{
+	int trisPerInstance = scene.indexCount / 3;
+	vec4 l = scene.modelView * scene.lightPosition;
+	vec3 light(l.x, l.y, l.z);
+
+	batch.bins.assign(target.tilesX * target.tilesY, std::vector<int>());
+
+	int transformInstance = -1;
+	mat3x4 instanceView;
+
+	for (long long t = begin; t < end; ++t){
+		int instance = int(t / trisPerInstance);
+		int first = int(t % trisPerInstance) * 3;
+
+		//a batch is a run of triangles, the transform changes once per instance
+		if (instance != transformInstance){
+			instanceView = instanceTransform(scene, scene.offsets[instance]);
+			transformInstance = instance;
+		}
+
+		int base = int(batch.verts.size());
+		batch.verts.resize(base + 3);
+		for (int i = 0; i < 3; ++i)
+			shadeVertex(scene, instanceView, light, scene.indices[first + i], batch.verts[base + i]);
+
+		//all three outside the same side of the frustum, nothing to draw
+		const vec4& a = batch.verts[base].clip;
+		const vec4& b = batch.verts[base + 1].clip;
+		const vec4& c = batch.verts[base + 2].clip;
+		if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+			(a.z > a.w && b.z > b.w && c.z > c.w)){
+			batch.verts.resize(base);
+			continue;
+		}
+
+		clipTriangle(batch, target, base);
+	}
+}
+
+//vertex stage
+#pragma endregion
+
+#pragma region fragment stage
+
+static inline float texel(const SoftTexture& texture, int x, int y, int channel)
+{
+	x %= texture.width;
+	y %= texture.height;
+	if (x < 0) x += texture.width;
+	if (y < 0) y += texture.height;
+	return texture.rgb[(y * texture.width + x) * 3 + channel] / 255.0f;
+}
+
+//GL_LINEAR with GL_REPEAT on both axes
+static vec4 sampleTexture(const SoftTexture& texture, const vec2& st)
+{
+	float u = st.x * texture.width - 0.5f;
+	float v = st.y * texture.height - 0.5f;
+	int x0 = int(std::floor(u));
+	int y0 = int(std::floor(v));
+	float fx = u - x0;
+	float fy = v - y0;
+
+	vec4 color(0, 0, 0, 1);
+	for (int c = 0; c < 3; ++c){
+		float a = texel(texture, x0, y0, c) + (texel(texture, x0 + 1, y0, c) - texel(texture, x0, y0, c)) * fx;
+		float b = texel(texture, x0, y0 + 1, c) + (texel(texture, x0 + 1, y0 + 1, c) - texel(texture, x0, y0 + 1, c)) * fx;
+		color[c] = a + (b - a) * fy;
+	}
+	return color;
+}
+
+//Blinn-Phong with the texture, as fshaderTexture.glsl
+static vec4 shadeFragment(const SoftScene& scene, const vec3& N, const vec3& E, const vec3& L, const vec2& tex)
+{
+	vec3 fN = normalize(N);
+	vec3 fE = normalize(E);
+	vec3 fL = normalize(L);
+
+	vec3 fH = normalize(fL + fE);
+
+	vec4 T = sampleTexture(*scene.texture, tex);
+
+	float lDotN = dot(fL, fN);
+	vec4 ambient = scene.ambientProduct * T;
+	vec4 diffuse = std::max(lDotN, 0.0f) * scene.diffuseProduct * T;
+	vec4 specular = std::pow(std::max(dot(fN, fH), 0.0f), scene.shininess) * scene.specularProduct;
+
+	if (lDotN < 0.0f)
+		specular = vec4(0.0, 0.0, 0.0, 1.0);
+
+	vec4 color = ambient + diffuse + specular;
+	return vec4(color.x, color.y, color.z, 1.0);
+}
+
+static inline unsigned char toByte(float c)
+{
+	c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+	return (unsigned char)(c * 255.0f + 0.5f);
+}
+
+//edge function a * x + b * y + c, positive inside once the triangle is wound counterclockwise
+struct SoftEdge{
+	float	a, b, c;
+	bool	topLeft;
+};
+
+static SoftEdge makeEdge(float x0, float y0, float x1, float y1, float sign)
+{
+	SoftEdge e;
+	e.a = sign * (y0 - y1);
+	e.b = sign * (x1 - x0);
+	e.c = -(e.a * x0 + e.b * y0);
+
+	//pixels exactly on a shared edge belong to the triangle on its top or left side
+	e.topLeft = e.a > 0.0f || (e.a == 0.0f && e.b < 0.0f);
+	return e;
+}
+
+//bit i is set when pixel x + i of row y is inside all three edges
+static inline int coverage4(const SoftEdge* edges, float x, float y, float w[3][4])
+{
+#ifdef SOFT_SSE
+	__m128 px = _mm_add_ps(_mm_set1_ps(x), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int i = 0; i < 3; ++i){
+		__m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[i].a), px),
+								  _mm_set1_ps(edges[i].b * (y + 0.5f) + edges[i].c));
+		_mm_storeu_ps(w[i], value);
+
+		__m128 zero = _mm_setzero_ps();
+		__m128 in = edges[i].topLeft ? _mm_cmpge_ps(value, zero) : _mm_cmpgt_ps(value, zero);
+		inside = _mm_and_ps(inside, in);
+	}
+	return _mm_movemask_ps(inside);
+#else
+	int mask = 0;
+	for (int p = 0; p < 4; ++p){
+		bool in = true;
+		for (int i = 0; i < 3; ++i){
+			w[i][p] = edges[i].a * (x + p + 0.5f) + edges[i].b * (y + 0.5f) + edges[i].c;
+			in = in && (edges[i].topLeft ? w[i][p] >= 0.0f : w[i][p] > 0.0f);
+		}
+		if (in)
+			mask |= 1 << p;
+	}
+	return mask;
+#endif
+}
+
+//depth test four pixels against the tile depth, returns the passing subset of mask
+static inline int depth4(float* depth, const float* z, int mask)
+{
+#ifdef SOFT_SSE
+	__m128 zv = _mm_loadu_ps(z);
+	__m128 pass = _mm_and_ps(_mm_cmplt_ps(zv, _mm_loadu_ps(depth)), _mm_cmple_ps(zv, _mm_set1_ps(1.0f)));
+	return mask & _mm_movemask_ps(pass);
+#else
+	int pass = 0;
+	for (int p = 0; p < 4; ++p){
+		if (z[p] < depth[p] && z[p] <= 1.0f)
+			pass |= 1 << p;
+	}
+	return mask & pass;
+#endif
+}
+
+static void rasterTriangle(const SoftScene& scene, const SoftTarget& target, const SoftBatch& batch,
+						   const SoftTriangle& tri, int tileX, int tileY, float* depth)
+{
+	int x0 = std::max(tri.minX, tileX);
+	int y0 = std::max(tri.minY, tileY);
+	int x1 = std::min(tri.maxX, tileX + TILESIZE - 1);
+	int y1 = std::min(tri.maxY, tileY + TILESIZE - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	//both faces are drawn, so wind every triangle the same way
+	float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+	float sign = area > 0.0f ? 1.0f : -1.0f;
+
+	//edge i is opposite vertex i, so its value is the weight of vertex i
+	SoftEdge edges[3];
+	edges[0] = makeEdge(tri.x[1], tri.y[1], tri.x[2], tri.y[2], sign);
+	edges[1] = makeEdge(tri.x[2], tri.y[2], tri.x[0], tri.y[0], sign);
+	edges[2] = makeEdge(tri.x[0], tri.y[0], tri.x[1], tri.y[1], sign);
+	float invArea = 1.0f / (sign * area);
+
+	const SoftVertex& v0 = batch.verts[tri.v[0]];
+	const SoftVertex& v1 = batch.verts[tri.v[1]];
+	const SoftVertex& v2 = batch.verts[tri.v[2]];
+
+	float w[3][4];
+	float z[4];
+
+	for (int y = y0; y <= y1; ++y){
+		float* depthRow = depth + (y - tileY) * TILESIZE;
+		unsigned char* colorRow = target.rgba + (size_t(y) * target.width) * 4;
+
+		for (int x = x0; x <= x1; x += 4){
+			int mask = coverage4(edges, float(x), float(y), w);
+
+			//the last group of the row may run past the bounds
+			if (x1 - x < 3)
+				mask &= (1 << (x1 - x + 1)) - 1;
+			if (!mask)
+				continue;
+
+			for (int p = 0; p < 4; ++p){
+				w[0][p] *= invArea;
+				w[1][p] *= invArea;
+				w[2][p] *= invArea;
+
+				//depth is linear in screen space
+				z[p] = w[0][p] * tri.z[0] + w[1][p] * tri.z[1] + w[2][p] * tri.z[2];
+			}
+
+			//the depth tile is padded so four floats can always be read
+			mask = depth4(depthRow + (x - tileX), z, mask);
+
+			for (int p = 0; p < 4; ++p){
+				if (!(mask & (1 << p)))
+					continue;
+
+				depthRow[x - tileX + p] = z[p];
+
+				//attributes are perspective correct
+				float b0 = w[0][p] * tri.invW[0];
+				float b1 = w[1][p] * tri.invW[1];
+				float b2 = w[2][p] * tri.invW[2];
+				float inv = 1.0f / (b0 + b1 + b2);
+				b0 *= inv;
+				b1 *= inv;
+				b2 *= inv;
+
+				vec4 color = shadeFragment(scene,
+										   b0 * v0.N + b1 * v1.N + b2 * v2.N,
+										   b0 * v0.E + b1 * v1.E + b2 * v2.E,
+										   b0 * v0.L + b1 * v1.L + b2 * v2.L,
+										   b0 * v0.tex + b1 * v1.tex + b2 * v2.tex);
+
+				unsigned char* pixel = colorRow + (x + p) * 4;
+				pixel[0] = toByte(color.x);
+				pixel[1] = toByte(color.y);
+				pixel[2] = toByte(color.z);
+				pixel[3] = toByte(color.w);
+			}
+		}
+	}
+}
+
+//tiles [begin, end), each tile runs every bin in submission order
+static void rasterStage(const SoftScene& scene, const SoftTarget& target, const std::vector<SoftBatch>& batches,
+						int begin, int end)
+{
+	//padded by a group of four for the last pixels of a row
+	std::vector<float> depth(TILESIZE * TILESIZE + 4);
+	unsigned char clear[4] = { toByte(scene.clearColor.x), toByte(scene.clearColor.y),
+							   toByte(scene.clearColor.z), toByte(scene.clearColor.w) };
+
+	for (int tile = begin; tile < end; ++tile){
+		int tileX = (tile % target.tilesX) * TILESIZE;
+		int tileY = (tile / target.tilesX) * TILESIZE;
+		int tileW = std::min(TILESIZE, target.width - tileX);
+		int tileH = std::min(TILESIZE, target.height - tileY);
+
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		for (int y = 0; y < tileH; ++y){
+			unsigned char* row = target.rgba + (size_t(tileY + y) * target.width + tileX) * 4;
+			for (int x = 0; x < tileW; ++x)
+				memcpy(row + x * 4, clear, 4);
+		}
+
+		for (size_t b = 0; b < batches.size(); ++b){
+			const SoftBatch& batch = batches[b];
+			const std::vector<int>& bin = batch.bins[tile];
+			for (size_t i = 0; i < bin.size(); ++i)
+				rasterTriangle(scene, target, batch, batch.tris[bin[i]], tileX, tileY, &depth[0]);
+		}
+	}
+}
+
+//fragment stage
+#pragma endregion
+
+//what the stages of one softRender call share
+struct SoftFrame{
+	const SoftScene*		scene;
+	const SoftTarget*		target;
+	std::vector<SoftBatch>*	batches;
+	long long				triangles;
+	int						batchCount;
+};
+
+static void geometryJob(int begin, int end, void* data)
+{
+	SoftFrame& f = *(SoftFrame*)data;
+	for (int b = begin; b < end; ++b)
+		geometryStage(*f.scene, *f.target, (*f.batches)[b], b * f.triangles / f.batchCount, (b + 1) * f.triangles / f.batchCount);
+}
+
+static void rasterJob(int begin, int end, void* data)
+{
+	SoftFrame& f = *(SoftFrame*)data;
+	rasterStage(*f.scene, *f.target, *f.batches, begin, end);
+}
+
+void softRender(const SoftScene& scene, int width, int height, std::vector<unsigned char>& rgba)
+{
+	rgba.resize(size_t(width) * height * 4);
+
+	SoftTarget target;
+	target.width = width;
+	target.height = height;
+	target.tilesX = (width + TILESIZE - 1) / TILESIZE;
+	target.tilesY = (height + TILESIZE - 1) / TILESIZE;
+	target.rgba = &rgba[0];
+
+	//geometry, batch b takes the b-th run of triangles so the bins keep draw order
+	SoftFrame frame = { &scene, &target, NULL, (long long)(scene.indexCount / 3) * scene.instanceCount, jobThreads() };
+	std::vector<SoftBatch> batches(frame.batchCount);
+	frame.batches = &batches;
+	parallelFor(0, frame.batchCount, 1, geometryJob, &frame, "softGeometry");
+
+	//rasterization, tiles never overlap so the pieces share the image without locks
+	parallelFor(0, target.tilesX * target.tilesY, 1, rasterJob, &frame, "softRaster");
+}
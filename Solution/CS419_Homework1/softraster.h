@@ -0,0 +1,56 @@
+#ifndef __SOFT_RASTER__
+#define __SOFT_RASTER__
+
+#include <vector>
+#include "openglutl.h"
+
+//CPU reference renderer for the sphere pipeline
+//runs the math of vshaderTexture.glsl and fshaderTexture.glsl in C++ so images can be
+//made without a GPU, and so GPU output can be checked against a known good image
+//the screen is split into tiles that worker threads rasterize independently,
+//coverage and depth are tested four pixels at a time with SSE where available
+
+//RGB texture with 8 bits per channel, rows top to bottom like the GL upload
+struct SoftTexture{
+	int							width;
+	int							height;
+	std::vector<unsigned char>	rgb;
+};
+
+//load an image the same way loadTextures does, including the NTSC safe range
+bool loadSoftTexture(const char* path, SoftTexture& texture);
+
+//everything the two shaders read, the uniforms of main.cpp and the vertex streams
+struct SoftScene{
+	//indexed triangle list as genSphere builds it
+	const vec4*		points;
+	const vec3*		normals;
+	const vec2*		texCoords;
+	int				vertexCount;
+	const GLuint*	indices;
+	int				indexCount;
+
+	//per-instance xyz offset and w scale
+	const vec4*	offsets;
+	int			instanceCount;
+
+	vec4		rot;
+	mat4		modelView;
+	mat4		projection;
+
+	vec4		lightPosition;
+	vec4		ambientProduct;
+	vec4		diffuseProduct;
+	vec4		specularProduct;
+	float		shininess;
+
+	vec4		clearColor;
+
+	const SoftTexture*	texture;
+};
+
+//render the scene into rgba (4 bytes per pixel, bottom row first like glReadPixels)
+//geometry and tiles are split across the job system
+void softRender(const SoftScene& scene, int width, int height, std::vector<unsigned char>& rgba);
+
+#endif //__SOFT_RASTER__
@@ -0,0 +1,68 @@
+#version 430
+
+//picks how finely each edge of the base octahedron is split from its length on screen
+//an edge is measured the same way from both of its patches so neighbours never crack
+
+layout(vertices = 3) out;
+
+in vec3 cPosition[];
+in vec4 cOffset[];
+
+out vec3 ePosition[];
+out vec4 eOffset[];
+
+uniform mat4 ModelView, Projection;
+uniform vec4 Rot;
+
+//target length of a generated edge in pixels, and the size of the viewport
+uniform float TessEdge;
+uniform vec2 ViewSize;
+
+#define MAXLEVEL 64.0
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+//window position of a point on the unit sphere, w < 0 flags a point behind the eye
+vec3 toScreen(vec3 p){
+	vec4 rPosition = q_rot(Rot, vec4(p, 1.0));
+	rPosition.xyz = rPosition.xyz * cOffset[0].w + cOffset[0].xyz;
+	vec4 clip = Projection * ModelView * rPosition;
+	return vec3(clip.xy / clip.w * 0.5 * ViewSize, clip.w);
+}
+
+//the arc from a to b measured as two chords through its midpoint
+float edgeLevel(vec3 a, vec3 b){
+	vec3 sa = toScreen(a);
+	vec3 sb = toScreen(b);
+	vec3 sm = toScreen(normalize(a + b));
+	if (sa.z <= 0.0 || sb.z <= 0.0 || sm.z <= 0.0)
+		return MAXLEVEL;
+
+	float pixels = distance(sa.xy, sm.xy) + distance(sm.xy, sb.xy);
+	return clamp(pixels / TessEdge, 1.0, MAXLEVEL);
+}
+
+void main()
+{
+	ePosition[gl_InvocationID] = cPosition[gl_InvocationID];
+	eOffset[gl_InvocationID] = cOffset[gl_InvocationID];
+
+	if (gl_InvocationID == 0){
+		//outer level i is the edge opposite corner i
+		gl_TessLevelOuter[0] = edgeLevel(cPosition[1], cPosition[2]);
+		gl_TessLevelOuter[1] = edgeLevel(cPosition[2], cPosition[0]);
+		gl_TessLevelOuter[2] = edgeLevel(cPosition[0], cPosition[1]);
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+	}
+}
@@ -0,0 +1,59 @@
+#version 430
+
+//places the generated vertices on the unit sphere and does the work of
+//vshaderTexture.glsl for them, including the texture mapping of genPoint
+
+layout(triangles, equal_spacing, ccw) in;
+
+in vec3 ePosition[];
+in vec4 eOffset[];
+
+out vec3 N;
+out vec3 E;
+out vec3 L;
+out vec2 texCoord;
+out vec3 S;
+
+uniform mat4 ModelView, Projection;
+uniform vec4 LightPosition, Rot;
+
+#define M_PI 3.14159265358979323846
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+
+void main()
+{
+	vec3 nor = normalize(gl_TessCoord.x * ePosition[0] + gl_TessCoord.y * ePosition[1] + gl_TessCoord.z * ePosition[2]);
+	vec4 offset = eOffset[0];
+
+	vec4 rPosition = q_rot(Rot, vec4(nor, 1.0));
+	rPosition.xyz = rPosition.xyz * offset.w + offset.xyz;
+	vec3 rNormal = q_rot(Rot, vec4(nor, 0.0)).xyz;
+
+	N = (ModelView * vec4(rNormal, 0.0)).xyz;
+	E = -(ModelView * rPosition).xyz;
+	L = (ModelView * LightPosition).xyz;
+
+	if(LightPosition.w != 0.0)
+	{
+		L = L + E.xyz;
+	}
+
+	S = rPosition.xyz - LightPosition.xyz;
+
+	texCoord = vec2(0.5 + atan(-nor.z, -nor.x) / (M_PI * 2.0), 0.5 - asin(-nor.y) / M_PI);
+
+	gl_Position = Projection * ModelView * rPosition;
+}
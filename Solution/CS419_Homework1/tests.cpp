@@ -0,0 +1,616 @@
+#include <cstdio>
+#include <cmath>
+#include "openglutl.h"
+#include "trackball.h"
+#include "timestep.h"
+#include "meshopt.h"
+#include "simdmath.h"
+#include "tvec.h"
+#include "jobs.h"
+#include "arena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+//unit tests for the CPU side math, built with MATH_ONLY so no GL is needed
+//returns the number of failed checks
+
+static int failures = 0;
+
+#define CHECK( cond ) do { if (!(cond)) { ++failures; \
+	printf("[%s:%d] check failed: %s\n", __FILE__, __LINE__, #cond); } } while(0)
+
+static bool near(float a, float b, float eps = 1.0e-5f)
+{
+	return std::fabs(a - b) <= eps;
+}
+
+static bool near(const vec3& a, const vec3& b, float eps = 1.0e-5f)
+{
+	return near(a.x, b.x, eps) && near(a.y, b.y, eps) && near(a.z, b.z, eps);
+}
+
+static bool near(const vec4& a, const vec4& b, float eps = 1.0e-5f)
+{
+	return near(a.x, b.x, eps) && near(a.y, b.y, eps) && near(a.z, b.z, eps) && near(a.w, b.w, eps);
+}
+
+static bool near(const mat4& a, const mat4& b, float eps = 1.0e-5f)
+{
+	for (int i = 0; i < 4; ++i){
+		if (!near(a[i], b[i], eps))
+			return false;
+	}
+	return true;
+}
+
+static void testVec()
+{
+	vec4 a(1, 2, 3, 4);
+	vec4 b(5, 6, 7, 8);
+
+	CHECK(near(dot(a, b), 70.0f));
+	CHECK(near(a * b, vec4(5, 12, 21, 32)));
+	CHECK(near(a + b, vec4(6, 8, 10, 12)));
+	CHECK(near(b - a, vec4(4, 4, 4, 4)));
+	CHECK(near(2.0f * a, vec4(2, 4, 6, 8)));
+	CHECK(near(length(vec3(3, 4, 0)), 5.0f));
+	CHECK(near(normalize(vec3(0, 0, 9)), vec3(0, 0, 1)));
+	CHECK(near(cross(vec3(1, 0, 0), vec3(0, 1, 0)), vec3(0, 0, 1)));
+	CHECK(near(dot(vec2(1, 2), vec2(3, 4)), 11.0f));
+
+	//chains, with CS419_VEC_EXPR these evaluate as one expression
+	CHECK(near(a * b + 2.0f * a - b / 2.0f, vec4(4.5f, 13, 23.5f, 36)));
+	CHECK(near(-(a - b) * 0.5f, vec4(2, 2, 2, 2)));
+	CHECK(near(normalize(vec3(1, 2, 3) + vec3(-1, -2, 1)), vec3(0, 0, 1)));
+	vec4 c = a;
+	c += a * b - a;
+	CHECK(near(c, vec4(5, 12, 21, 32)));
+}
+
+static void testMat()
+{
+	mat4 t = Translate(1, 2, 3);
+	mat4 s = Scale(2, 2, 2);
+
+	CHECK(near(t * mat4(), t));
+	CHECK(near(transpose(transpose(t)), t));
+	CHECK(near(transpose(t)[3], vec4(1, 2, 3, 1)));
+	CHECK(near(matrixCompMult(t, t)[0], vec4(1, 0, 0, 1)));
+	CHECK(near(t * vec4(1, 1, 1, 1), vec4(2, 3, 4, 1)));
+	CHECK(near(t * vec4(1, 1, 1, 0), vec4(1, 1, 1, 0)));
+	CHECK(near((t * s) * vec4(1, 1, 1, 1), vec4(3, 4, 5, 1)));
+	CHECK(near((s * t) * vec4(1, 1, 1, 1), vec4(4, 6, 8, 1)));
+
+	mat4 r = RotateZ(90);
+	CHECK(near(r * vec4(1, 0, 0, 0), vec4(0, 1, 0, 0)));
+
+	mat2 m2(1, 2, 3, 4);
+	CHECK(near((m2 * mat2())[1][0], m2[1][0]));
+	CHECK(near((transpose(m2))[0][1], m2[1][0]));
+	CHECK(near((transpose(m2))[1][0], m2[0][1]));
+
+	mat3 m3(1, 2, 3, 4, 5, 6, 7, 8, 9);
+	CHECK(near(transpose(m3)[0], vec3(m3[0][0], m3[1][0], m3[2][0])));
+	CHECK(near(matrixCompMult(m3, mat3())[1], vec3(0, m3[1][1], 0)));
+
+	CHECK(near((t + s * 2.0f - mat4(4)) / 2.0f, mat4(0.5f, 0, 0, 0, 0, 0.5f, 0, 0, 0, 0, 0.5f, 0, 0.5f, 1, 1.5f, -0.5f)));
+	CHECK(near((m3 - m3 * 0.5f)[2], vec3(1.5f, 3, 4.5f)));
+}
+
+static void testCamera()
+{
+	vec4 eye(0, 0, 2, 1);
+	vec4 at(0, 0, 0, 1);
+	vec4 up(0, 1, 0, 0);
+	mat4 mv = LookAt(eye, at, up);
+
+	//the eye ends up at the origin looking down -z
+	CHECK(near(mv * eye, vec4(0, 0, 0, 1)));
+	CHECK(near(mv * at, vec4(0, 0, -2, 1)));
+
+	//points on the near and far planes land on -1 and 1 after the divide
+	mat4 p = Perspective(90, 1, 0.1f, 15);
+	vec4 n = p * vec4(0, 0, -0.1f, 1);
+	vec4 f = p * vec4(0, 0, -15, 1);
+	CHECK(near(n.z / n.w, -1.0f, 1.0e-4f));
+	CHECK(near(f.z / f.w, 1.0f, 1.0e-4f));
+
+	//90 degree field of view, the frustum edge maps to the edge of the screen
+	vec4 e = p * vec4(1, 0, -1, 1);
+	CHECK(near(e.x / e.w, 1.0f, 1.0e-4f));
+
+	vec4 o = Ortho(-1, 1, -1, 1, 1, 3) * vec4(1, -1, -1, 1);
+	CHECK(near(o, vec4(1, -1, -1, 1)));
+
+	//unprojecting undoes the projection
+	CHECK(near(inverse(p) * p, mat4(), 1.0e-4f));
+	CHECK(near(inverse(mv) * vec4(0, 0, -2, 1), at));
+}
+
+static void testAffine()
+{
+	mat4 t = Translate(1, 2, 3);
+	mat4 r = RotateX(30) * RotateY(40);
+	mat4 s = Scale(2, 4, 8);
+	mat3x4 at(t), ar(r), as(s);
+
+	//composing agrees with the full matrices
+	CHECK(near(toMat4(at * ar * as), t * r * s));
+	CHECK(near(toMat4(ar * at), r * t));
+
+	vec4 p(1, -2, 0.5f, 1);
+	CHECK(near((at * ar * as) * p, (t * r * s) * p));
+	CHECK(near(transformPoint(at, vec3(1, 1, 1)), vec3(2, 3, 4)));
+	CHECK(near(transformVector(at, vec3(1, 1, 1)), vec3(1, 1, 1)));
+
+	//both inverses undo the transform, the rigid one only for rotation and translation
+	mat3x4 rigid = at * ar;
+	CHECK(near(toMat4(inverse(at * ar * as) * (at * ar * as)), mat4(), 1.0e-5f));
+	CHECK(near(toMat4(inverse(rigid)), inverse(t * r), 1.0e-5f));
+	CHECK(near(toMat4(rigidInverse(rigid)), toMat4(inverse(rigid)), 1.0e-5f));
+	CHECK(near(rigidInverse(rigid) * (rigid * p), p));
+}
+
+static void testTvec()
+{
+	//every half survives the trip through float, NaNs stay NaN
+	bool roundTrip = true;
+	for (int h = 0; h < 0x10000; ++h){
+		float f = halfToFloat((unsigned short)h);
+		if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff))
+			roundTrip = roundTrip && f != f && (floatToHalf(f) & 0x7fff) > 0x7c00;
+		else
+			roundTrip = roundTrip && floatToHalf(f) == h;
+	}
+	CHECK(roundTrip);
+
+	//halfway between two halves rounds to the even one, subnormals included
+	bool nearestEven = true;
+	for (int h = 0; h < 0x7bff; ++h){
+		float mid = 0.5f * (halfToFloat((unsigned short)h) + halfToFloat((unsigned short)(h + 1)));
+		nearestEven = nearestEven && floatToHalf(mid) == ((h & 1) ? h + 1 : h);
+	}
+	CHECK(nearestEven);
+	CHECK(floatToHalf(1.0f) == 0x3c00);
+	CHECK(floatToHalf(-2.0f) == 0xc000);
+	CHECK(floatToHalf(65504.0f) == 0x7bff);
+	CHECK(floatToHalf(65520.0f) == 0x7c00);
+	CHECK(floatToHalf(1.0e-8f) == 0);
+
+	//the batch agrees with the scalar conversion
+	const int count = 1027;
+	std::vector<float> in(count), back(count);
+	std::vector<unsigned short> out(count);
+	srand(48);
+	for (int i = 0; i < count; ++i)
+		in[i] = (rand() / float(RAND_MAX) - 0.5f) * std::pow(2.0f, float(i % 40 - 24));
+	floatsToHalves(&in[0], &out[0], count);
+	halvesToFloats(&out[0], &back[0], count);
+	bool batch = true;
+	for (int i = 0; i < count; ++i)
+		batch = batch && out[i] == floatToHalf(in[i]) && back[i] == halfToFloat(out[i]);
+	CHECK(batch);
+
+	//double keeps what float loses far from the origin
+	dvec3 far(1.0e8, 0, 0);
+	dvec3 step(1.0e-3, 2.0e-3, 0);
+	CHECK(std::fabs((far + step - far).x - 1.0e-3) < 1.0e-7);
+	CHECK(near(toVec(cross(dvec3(1, 0, 0), dvec3(0, 1, 0))), vec3(0, 0, 1)));
+	CHECK(near(float(length(dvec3(3, 4, 0))), 5.0f));
+	CHECK(near(toVec(2.0 * dvec4(vec4(1, 2, 3, 4)) - dvec4(1.0)), vec4(1, 3, 5, 7)));
+
+	//the matrices agree with mat4
+	mat4 t = Translate(1, 2, 3);
+	mat4 r = RotateX(30) * RotateY(40);
+	vec4 p(1, -2, 0.5f, 1);
+	CHECK(near(toMat(dmat4(t) * dmat4(r)), t * r));
+	CHECK(near(toVec(dmat4(t) * dvec4(p)), t * p));
+	CHECK(near(toMat(transpose(dmat4(r))), transpose(r)));
+	tmat<double, 3, 4> top;
+	for (int i = 0; i < 3; ++i)
+		top[i] = dvec4(t[i]);
+	CHECK(near(toVec(top * dvec4(p)), vec3(2, 0, 3.5f)));
+
+	//half vectors do their arithmetic in float and round once per element
+	hvec3 h = normalize(hvec3(vec3(3, 0, 4)));
+	CHECK(near(toVec(h), vec3(0.6f, 0, 0.8f), 1.0e-3f));
+	CHECK(toVec(hvec2(1.5f, -2) * 2.0f).x == 3.0f);
+	std::vector<vec4> points(5, vec4(0.25f, -1, 1000, 1));
+	std::vector<hvec4> packed(5);
+	toHalves(&points[0], &packed[0], 5);
+	CHECK(toVec(packed[4]) == vec4(0.25f, -1, 1000, 1));
+}
+
+static void testNormal()
+{
+	//non-uniform scale, normals scale by the inverse
+	mat3 n = Normal(Scale(2, 4, 8));
+	CHECK(near(n[0][0], 0.5f));
+	CHECK(near(n[1][1], 0.25f));
+	CHECK(near(n[2][2], 0.125f));
+	CHECK(near(n[0][1], 0.0f));
+
+	//a rotation is its own normal matrix
+	mat4 r = RotateX(30) * RotateY(40);
+	mat3 nr = Normal(r);
+	for (int i = 0; i < 3; ++i){
+		for (int j = 0; j < 3; ++j)
+			CHECK(near(nr[i][j], r[i][j]));
+	}
+}
+
+static void testTrackball()
+{
+	vec4 q = normalize(vec4(1, 2, 3, 4));
+	CHECK(near(q_multiply(vec4(1, 0, 0, 0), q), q));
+	CHECK(near(q_multiply(q, vec4(1, 0, 0, 0)), q));
+
+	//i * j = k
+	CHECK(near(q_multiply(vec4(0, 1, 0, 0), vec4(0, 0, 1, 0)), vec4(0, 0, 0, 1)));
+
+	//the window center maps to the top of the hemisphere
+	CHECK(near(hemisphereMap(256, 128, 512, 256), vec3(0, 0, 1), 1.0e-3f));
+
+	//no cursor movement is no rotation rather than NaNs
+	CHECK(near(trackballRotation(100, 100, 100, 100, 1.0, 512, 512), vec4(1, 0, 0, 0)));
+
+	//dragging right turns about +y
+	vec4 r = trackballRotation(200, 256, 300, 256, 1.0, 512, 512);
+	CHECK(near(r.y, 0.0f) && near(r.w, 0.0f));
+	CHECK(r.z > 0.0f && near(r.x * r.x + r.z * r.z, 1.0f));
+}
+
+static void testTimestep()
+{
+	//the same stretch of time gives the same number of steps however it is split up
+	Timestep a, b;
+	initTimestep(a, SIMDT);
+	initTimestep(b, SIMDT);
+	int stepsA = 0, stepsB = 0;
+	for (int i = 0; i < 60; ++i)
+		stepsA += advanceTimestep(a, 1.0 / 60.0);
+	for (int i = 0; i < 1000; ++i)
+		stepsB += advanceTimestep(b, 1.0 / 1000.0);
+	CHECK(stepsA == 120);
+	CHECK(stepsB == 119 || stepsB == 120);
+	CHECK(timestepAlpha(b) >= 0.0 && timestepAlpha(b) < 1.0);
+
+	//a long stall is clamped instead of simulated
+	CHECK(advanceTimestep(a, 10.0) <= int(MAXFRAMETIME / SIMDT) + 1);
+
+	vec4 q0(1, 0, 0, 0);
+	vec4 q1(cos(0.5f), sin(0.5f), 0, 0);
+	CHECK(near(q_nlerp(q0, q1, 0), q0));
+	CHECK(near(q_nlerp(q0, q1, 1), q1));
+	CHECK(near(q_nlerp(q0, q1, 0.5f), vec4(cos(0.25f), sin(0.25f), 0, 0)));
+	CHECK(near(q_nlerp(q0, -q1, 0.5f), vec4(cos(0.25f), sin(0.25f), 0, 0)));
+	CHECK(near(length(q_nlerp(q0, q1, 0.3f)), 1.0f));
+}
+
+//triangle with its smallest index first, the winding kept
+static void canonicalTriangle(const GLuint* t, GLuint out[3])
+{
+	int k = (t[1] < t[0] && t[1] < t[2]) ? 1 : (t[2] < t[0] && t[2] < t[1]) ? 2 : 0;
+	for (int i = 0; i < 3; ++i)
+		out[i] = t[(k + i) % 3];
+}
+
+static std::vector<GLuint> sortedTriangles(const std::vector<GLuint>& indices)
+{
+	std::vector<GLuint> result;
+	std::vector<std::vector<GLuint> > triangles;
+	for (size_t i = 0; i < indices.size(); i += 3){
+		GLuint t[3];
+		canonicalTriangle(&indices[i], t);
+		triangles.push_back(std::vector<GLuint>(t, t + 3));
+	}
+	std::sort(triangles.begin(), triangles.end());
+	for (size_t i = 0; i < triangles.size(); ++i)
+		result.insert(result.end(), triangles[i].begin(), triangles[i].end());
+	return result;
+}
+
+static void testMeshopt()
+{
+	//a 40x40 grid in column order, like the sphere loop emits it
+	const int side = 40;
+	const int vertexCount = (side + 1) * (side + 1);
+	std::vector<GLuint> indices;
+	for (int i = 0; i < side; ++i){
+		for (int j = 0; j < side; ++j){
+			GLuint a = i * (side + 1) + j, b = a + 1, c = a + side + 1, d = c + 1;
+			indices.push_back(a); indices.push_back(c); indices.push_back(b);
+			indices.push_back(b); indices.push_back(c); indices.push_back(d);
+		}
+	}
+
+	CacheStats before = analyzeVertexCache(indices, vertexCount);
+	std::vector<GLuint> optimized = indices;
+	optimizeVertexCache(optimized, vertexCount);
+	CacheStats after = analyzeVertexCache(optimized, vertexCount);
+
+	//same triangles with the same winding, shaded closer to once per vertex
+	CHECK(optimized.size() == indices.size());
+	CHECK(sortedTriangles(optimized) == sortedTriangles(indices));
+	CHECK(after.acmr < before.acmr);
+	CHECK(after.acmr < 0.8f);
+	CHECK(after.atvr >= 1.0f);
+
+	//the fetch order follows first use, so each new index is the next one
+	std::vector<GLuint> remap;
+	std::vector<GLuint> fetched = optimized;
+	optimizeVertexFetch(fetched, vertexCount, remap);
+	GLuint next = 0;
+	bool ordered = true;
+	for (size_t i = 0; i < fetched.size(); ++i){
+		if (fetched[i] == next)
+			++next;
+		else if (fetched[i] > next)
+			ordered = false;
+	}
+	CHECK(ordered);
+	for (size_t i = 0; i < fetched.size(); ++i)
+		CHECK(fetched[i] == remap[optimized[i]]);
+}
+
+//distance in representable floats, a and b of the same sign
+static int ulps(float a, float b)
+{
+	int ia, ib;
+	memcpy(&ia, &a, sizeof(ia));
+	memcpy(&ib, &b, sizeof(ib));
+	return std::abs(ia - ib);
+}
+
+static void testSimdMath()
+{
+	//the bounds documented in simdmath.h
+	const int count = 4099;
+	std::vector<float> x(count), y(count), s(count), c(count), out(count);
+
+	int sinUlps = 0, cosUlps = 0;
+	float nearZero = 0;
+	for (int i = 0; i < count; ++i)
+		x[i] = -8192.0f + 16384.0f * i / (count - 1);
+	sincosBatch(&x[0], &s[0], &c[0], count);
+	for (int i = 0; i < count; ++i){
+		float rs = float(std::sin(double(x[i])));
+		float rc = float(std::cos(double(x[i])));
+		if (std::fabs(rs) > 1e-3f)
+			sinUlps = std::max(sinUlps, ulps(s[i], rs));
+		else
+			nearZero = std::max(nearZero, std::fabs(s[i] - rs));
+		if (std::fabs(rc) > 1e-3f)
+			cosUlps = std::max(cosUlps, ulps(c[i], rc));
+		else
+			nearZero = std::max(nearZero, std::fabs(c[i] - rc));
+	}
+	CHECK(sinUlps <= 2);
+	CHECK(cosUlps <= 2);
+	CHECK(nearZero < 1e-9f);
+
+	//the tail of a batch goes through the scalar functions
+	CHECK(ulps(fastSin(x[count - 1]), s[count - 1]) <= 1);
+	CHECK(ulps(fastCos(x[count - 1]), c[count - 1]) <= 1);
+
+	int atanUlps = 0;
+	for (int i = 0; i < count; ++i){
+		float angle = 6.2831853f * i / count;
+		float radius = std::pow(10.0f, -3.0f + 6.0f * (i % 97) / 96.0f);
+		x[i] = radius * std::cos(angle);
+		y[i] = radius * std::sin(angle);
+	}
+	atan2Batch(&y[0], &x[0], &out[0], count);
+	for (int i = 0; i < count; ++i)
+		atanUlps = std::max(atanUlps, ulps(out[i], float(std::atan2(double(y[i]), double(x[i])))));
+	CHECK(atanUlps <= 3);
+	CHECK(fastAtan2(0.0f, 0.0f) == 0.0f);
+	CHECK(near(fastAtan2(0.0f, -1.0f), float(M_PI)));
+	CHECK(near(fastAtan2(1.0f, -0.0f), float(M_PI / 2)));
+
+	int asinUlps = 0;
+	for (int i = 0; i < count; ++i)
+		x[i] = -1.0f + 2.0f * i / (count - 1);
+	asinBatch(&x[0], &out[0], count);
+	for (int i = 0; i < count; ++i)
+		asinUlps = std::max(asinUlps, ulps(out[i], float(std::asin(double(x[i])))));
+	CHECK(asinUlps <= 2);
+
+	//the recurrence stays on the circle and lands on the last angle
+	sincosSteps(0.0, M_PI / 1000, 1001, &s[0], &c[0]);
+	CHECK(near(s[1000], 0.0f, 1e-6f));
+	CHECK(near(c[1000], -1.0f, 1e-6f));
+	CHECK(near(s[250], float(std::sin(M_PI / 4)), 1e-6f));
+}
+
+//parallelFor adds i into slot i, every slot must be hit exactly once
+static void addIndex(int begin, int end, void* data)
+{
+	std::atomic<int>* slots = (std::atomic<int>*)data;
+	for (int i = begin; i < end; ++i)
+		slots[i] += i;
+}
+
+//a parallelFor inside a parallelFor piece
+static void nestedFor(int begin, int end, void* data)
+{
+	std::atomic<int>* slots = (std::atomic<int>*)data;
+	for (int i = begin; i < end; ++i)
+		parallelFor(i * 100, (i + 1) * 100, 7, addIndex, slots);
+}
+
+struct OrderedJob{
+	std::atomic<int>*	step;
+	int					seen;
+};
+
+static void recordStep(void* data)
+{
+	OrderedJob* job = (OrderedJob*)data;
+	job->seen = (*job->step)++;
+}
+
+static void runJobsOnce(int threads)
+{
+	initJobs(threads);
+	CHECK(jobThreads() == threads);
+
+	const int count = 10000;
+	std::vector<std::atomic<int> > slots(count);
+	for (int i = 0; i < count; ++i)
+		slots[i] = 0;
+	parallelFor(0, count, 64, addIndex, &slots[0]);
+	int wrong = 0;
+	for (int i = 0; i < count; ++i)
+		wrong += slots[i] != i;
+	CHECK(wrong == 0);
+
+	//empty and single element ranges
+	parallelFor(5, 5, 1, addIndex, &slots[0]);
+	parallelFor(0, 1, 1000, addIndex, &slots[0]);
+	CHECK(slots[0] == 0 && slots[5] == 5);
+
+	for (int i = 0; i < count; ++i)
+		slots[i] = 0;
+	parallelFor(0, count / 100, 1, nestedFor, &slots[0]);
+	wrong = 0;
+	for (int i = 0; i < count; ++i)
+		wrong += slots[i] != i;
+	CHECK(wrong == 0);
+
+	//the second group waits for all of the first
+	std::atomic<int> step(0);
+	OrderedJob first[8], second[8];
+	JobCounter firstDone, secondDone;
+	for (int i = 0; i < 8; ++i){
+		first[i].step = second[i].step = &step;
+		runJob(recordStep, &first[i], &firstDone);
+	}
+	for (int i = 0; i < 8; ++i)
+		runJob(recordStep, &second[i], &secondDone, NULL, &firstDone);
+	waitJobs(&secondDone);
+	CHECK(firstDone.pending == 0 && secondDone.pending == 0);
+	bool ordered = true;
+	for (int i = 0; i < 8; ++i)
+		ordered = ordered && first[i].seen < 8 && second[i].seen >= 8;
+	CHECK(ordered);
+	CHECK(step == 16);
+
+	shutdownJobs();
+	CHECK(jobThreads() == 1);
+}
+
+static void testJobs()
+{
+	//without initJobs everything runs inline
+	std::atomic<int> slots[4];
+	for (int i = 0; i < 4; ++i)
+		slots[i] = 0;
+	parallelFor(0, 4, 1, addIndex, slots);
+	CHECK(slots[3] == 3);
+
+	runJobsOnce(1);
+	runJobsOnce(4);
+	runJobsOnce(4);
+}
+
+struct Pooled{
+	int		value;
+	double	weight;
+	Pooled() : value(7), weight(0.5) {}
+};
+
+static void testArena()
+{
+	static char memory[1024];
+	Arena arena;
+	initArena(arena, memory, sizeof(memory));
+
+	char* a = arenaArray<char>(arena, 3);
+	double* b = arenaArray<double>(arena, 4);
+	vec4* c = (vec4*)arenaAlloc(arena, 2 * sizeof(vec4), 64);
+	CHECK(a == memory);
+	CHECK((size_t)b % alignof(double) == 0 && (char*)b >= a + 3);
+	CHECK((size_t)c % 64 == 0 && (char*)c >= (char*)(b + 4));
+
+	//released memory is handed out again, the peak stays
+	size_t mark = arenaMark(arena);
+	int* d = arenaArray<int>(arena, 100);
+	arenaRelease(arena, mark);
+	CHECK(arenaArray<int>(arena, 100) == d);
+	size_t peak = arena.peak;
+	arenaReset(arena);
+	CHECK(arenaArray<char>(arena, 1) == memory && arena.peak == peak);
+
+	//the pool reuses freed slots and runs out at N
+	Pool<Pooled, 3> pool;
+	Pooled* p0 = pool.create();
+	Pooled* p1 = pool.create();
+	Pooled* p2 = pool.create();
+	CHECK(p0 && p1 && p2 && p0 != p1 && p1 != p2);
+	CHECK(p1->value == 7 && p1->weight == 0.5);
+	CHECK(pool.create() == NULL && pool.live == 3);
+	pool.destroy(p1);
+	CHECK(pool.create() == p1 && pool.live == 3);
+
+	//the hook counts operator new, exempt scopes are not counted
+	long long before = heapAllocations();
+	std::vector<int>* v = new std::vector<int>(10);
+	delete v;
+	CHECK(heapAllocations() - before == 2);
+	{
+		AllocExempt exempt;
+		std::vector<int> w(10);
+	}
+	CHECK(heapAllocations() - before == 2);
+	arenaArray<int>(frameArena, 1000);
+	CHECK(heapAllocations() - before == 2);
+	arenaReset(frameArena);
+
+	//instance sort scratch past the default frame arena, as genInstances reserves it
+	int sortCount = int(frameArena.capacity / sizeof(std::pair<float, int>)) + 1000;
+	reserveFrameArena(sortCount * (sizeof(std::pair<float, int>) + sizeof(vec4)));
+	std::pair<float, int>* order = arenaArray<std::pair<float, int> >(frameArena, sortCount);
+	vec4* sortedOffsets = arenaArray<vec4>(frameArena, sortCount);
+	for (int i = 0; i < sortCount; ++i)
+		order[i] = std::make_pair(float(sortCount - i), i);
+	std::sort(order, order + sortCount);
+	for (int i = 0; i < sortCount; ++i)
+		sortedOffsets[i] = vec4(float(order[i].second));
+	CHECK(order[0].second == sortCount - 1 && sortedOffsets[sortCount - 1].x == 0.0f);
+	arenaReset(frameArena);
+
+	//a checked frame that allocates fails the check instead of exiting
+	initAllocCheck(0);
+	allocFrameBegin();
+	allocFrameEnd();
+	CHECK(!allocCheckFailed());
+	allocFrameBegin();
+	delete new int(1);
+	allocFrameEnd();
+	CHECK(allocCheckFailed());
+}
+
+int main()
+{
+	testVec();
+	testMat();
+	testCamera();
+	testAffine();
+	testTvec();
+	testNormal();
+	testTrackball();
+	testTimestep();
+	testMeshopt();
+	testSimdMath();
+	testJobs();
+	testArena();
+
+	if (failures)
+		printf("%d checks failed\n", failures);
+	else
+		printf("All tests passed\n");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <thread>
+#include "timestep.h"
+
+//sleeps overshoot, the last stretch before a deadline is spun instead
+#define SPINTIME 0.002
+
+void initTimestep(Timestep& timestep, double dt)
+{
+	timestep.dt = dt;
+	timestep.accumulator = 0.0;
+	timestep.steps = 0;
+}
+
+int advanceTimestep(Timestep& timestep, double frameSeconds)
+{
+	if (frameSeconds > MAXFRAMETIME)
+		frameSeconds = MAXFRAMETIME;
+	if (frameSeconds < 0.0)
+		frameSeconds = 0.0;
+
+	timestep.accumulator += frameSeconds;
+
+	int steps = 0;
+	while (timestep.accumulator >= timestep.dt){
+		timestep.accumulator -= timestep.dt;
+		++steps;
+	}
+	timestep.steps += steps;
+	return steps;
+}
+
+double timestepAlpha(const Timestep& timestep)
+{
+	return timestep.accumulator / timestep.dt;
+}
+
+double timestepNow()
+{
+	static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void initFrameLimiter(FrameLimiter& limiter, double fps)
+{
+	limiter.interval = fps > 0.0 ? 1.0 / fps : 0.0;
+	limiter.next = timestepNow();
+}
+
+void waitFrameLimiter(FrameLimiter& limiter)
+{
+	if (limiter.interval <= 0.0)
+		return;
+
+	limiter.next += limiter.interval;
+
+	double now = timestepNow();
+
+	//fell more than a frame behind, start over rather than rushing to catch up
+	if (now > limiter.next){
+		limiter.next = now;
+		return;
+	}
+
+	if (limiter.next - now > SPINTIME)
+		std::this_thread::sleep_for(std::chrono::duration<double>(limiter.next - now - SPINTIME));
+
+	while (timestepNow() < limiter.next)
+		;
+}
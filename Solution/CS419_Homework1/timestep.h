@@ -0,0 +1,40 @@
+#ifndef __TIMESTEP__
+#define __TIMESTEP__
+
+//fixed timestep simulation and frame pacing
+//the simulation always advances in steps of dt no matter how fast frames are drawn,
+//frames draw an interpolation between the last two simulation states
+
+//simulation rate
+#define SIMDT (1.0 / 120.0)
+
+//longest frame the simulation catches up on, longer stalls are dropped
+#define MAXFRAMETIME 0.25
+
+struct Timestep{
+	double		dt;
+	double		accumulator;
+	long long	steps;
+};
+
+void initTimestep(Timestep& timestep, double dt);
+
+//add a frame worth of time, returns how many steps of dt to simulate now
+int advanceTimestep(Timestep& timestep, double frameSeconds);
+
+//how far the frame is between the previous and the current state, in [0, 1)
+double timestepAlpha(const Timestep& timestep);
+
+//wall clock in seconds
+double timestepNow();
+
+//sleeps so frames start no more often than fps per second, 0 is uncapped
+struct FrameLimiter{
+	double	interval;
+	double	next;
+};
+
+void initFrameLimiter(FrameLimiter& limiter, double fps);
+void waitFrameLimiter(FrameLimiter& limiter);
+
+#endif //__TIMESTEP__
@@ -0,0 +1,49 @@
+#include "trackball.h"
+#include "simdmath.h"
+
+vec4 q_multiply(vec4 a, vec4 b){
+
+	vec3 av(a.y, a.z, a.w);
+	vec3 bv(b.y, b.z, b.w);
+	vec3 v = cross(av, bv) + a.x * bv + b.x * av;
+	return vec4(a.x * b.x - dot(av, bv), v.x, v.y, v.z);
+}
+
+
+vec3 hemisphereMap(double x, double y, int width, int height){
+	double xAdj = (2 * x - width) / width;
+	double yAdj = (height - 2 * y) / height;
+	float len = sqrt(xAdj*xAdj + yAdj*yAdj);
+	len = (len < 1.0) ? len : 1.0;
+	return normalize(vec3(xAdj, yAdj, sqrt(1.001 - len * len)));
+
+
+}
+
+vec4 trackballRotation(double x0, double y0, double x1, double y1, double speed, int width, int height){
+	vec3 init = hemisphereMap(x0, y0, width, height);
+	vec3 fin = hemisphereMap(x1, y1, width, height);
+
+	vec3 n = cross(init, fin);
+
+	//no movement, normalizing n would give NaNs
+	float nLen = length(n);
+	if (nLen < DivideByZeroTolerance)
+		return vec4(1, 0, 0, 0);
+
+	vec3 axis = n / nLen;
+	float mag = speed * nLen;
+
+
+	float s, c;
+	fastSincos(mag / 2, s, c);
+	return vec4(c, axis.x * s, axis.y * s, axis.z * s);
+}
+
+vec4 q_nlerp(vec4 a, vec4 b, float t){
+	//q and -q are the same rotation, go the short way round
+	if (dot(a, b) < 0)
+		b = -b;
+
+	return normalize((1 - t) * a + t * b);
+}
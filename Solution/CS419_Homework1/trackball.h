@@ -0,0 +1,23 @@
+#ifndef __TRACKBALL__
+#define __TRACKBALL__
+
+#include "openglutl.h"
+
+//virtual trackball math, quaternions are stored (w, x, y, z) in a vec4
+
+//hamilton product a * b
+vec4 q_multiply(vec4 a, vec4 b);
+
+//project a window position onto the unit hemisphere facing the viewer
+vec3 hemisphereMap(double x, double y, int width, int height);
+
+//rotation that drags the hemisphere from (x0, y0) to (x1, y1), scaled by speed
+//returns the identity when the two points map to the same direction
+vec4 trackballRotation(double x0, double y0, double x1, double y1, double speed, int width, int height);
+
+//interpolate between two unit quaternions along the shorter arc, t in [0, 1]
+//normalized lerp, its speed along the arc is not constant but close enough when a and b
+//are only a simulation step apart
+vec4 q_nlerp(vec4 a, vec4 b, float t);
+
+#endif //__TRACKBALL__
@@ -0,0 +1,85 @@
+#include <cstring>
+#include "tvec.h"
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#define SIMD_F16C
+#endif
+
+//bit twiddling conversions after Fabian Giesen's float_to_half_fast3_rtne and half_to_float
+
+static unsigned int floatBits(float f)
+{
+	unsigned int u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static float bitsFloat(unsigned int u)
+{
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+unsigned short floatToHalf(float f)
+{
+	unsigned int u = floatBits(f);
+	unsigned int sign = (u >> 16) & 0x8000;
+	u &= 0x7fffffff;
+
+	//2^16 and above do not fit, NaN keeps a quiet NaN
+	if (u >= (127 + 16) << 23)
+		return sign | (u > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+	//below 2^-14 the half is subnormal, adding 0.5 lines its 10 bits up at the bottom
+	//of the float mantissa and the float addition does the rounding
+	const unsigned int denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+	if (u < 113 << 23)
+		return sign | (floatBits(bitsFloat(u) + bitsFloat(denormMagic)) - denormMagic);
+
+	//rebias the exponent and round the 13 dropped bits to nearest even
+	unsigned int odd = (u >> 13) & 1;
+	u -= (127 - 15) << 23;
+	u += 0xfff + odd;
+	return sign | (u >> 13);
+}
+
+float halfToFloat(unsigned short h)
+{
+	const unsigned int shiftedExp = 0x7c00 << 13;
+	unsigned int u = (h & 0x7fff) << 13;
+	unsigned int exp = u & shiftedExp;
+	u += (127 - 15) << 23;
+
+	if (exp == shiftedExp)	//infinity or NaN
+		u += (128 - 16) << 23;
+	else if (exp == 0){		//zero or subnormal, renormalize through the float unit
+		u += 1 << 23;
+		u = floatBits(bitsFloat(u) - bitsFloat(113 << 23));
+	}
+
+	return bitsFloat(u | ((h & 0x8000) << 16));
+}
+
+void floatsToHalves(const float* in, unsigned short* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_F16C
+	for (; i + 4 <= count; i += 4)
+		_mm_storel_epi64((__m128i*)(out + i), _mm_cvtps_ph(_mm_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+	for (; i < count; ++i)
+		out[i] = floatToHalf(in[i]);
+}
+
+void halvesToFloats(const unsigned short* in, float* out, int count)
+{
+	int i = 0;
+#ifdef SIMD_F16C
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(out + i, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(in + i))));
+#endif
+	for (; i < count; ++i)
+		out[i] = halfToFloat(in[i]);
+}
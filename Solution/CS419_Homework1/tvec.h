@@ -0,0 +1,446 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- tvec.h ---
+//
+//  vec.h and mat.h over any element type: tvec<T, N> for N = 2, 3, 4 and
+//  tmat<T, R, C> made of R rows of tvec<T, C>, row major like mat.h.
+//
+//	dvec, dmat		double, for CPU math that needs more than float precision
+//	hvec			16 bit half floats, storage only, to upload vertices with
+//					GL_HALF_FLOAT at half the size
+//
+//  Arithmetic on half elements is done in float and rounded back per element.
+//  vec2/3/4 and mat2/3/4 stay the GLfloat types everything else uses, they
+//  convert explicitly both ways (tvec<T, 4>( v ), toVec( t ), toMat( m )).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TVEC_H__
+#define __TVEC_H__
+
+#include <iostream>
+#include <cmath>
+#include "openglutl.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  half - IEEE 754 binary16
+//
+
+//round to nearest even, overflow goes to infinity and NaN stays NaN
+unsigned short floatToHalf( float f );
+float halfToFloat( unsigned short h );
+
+//the same for count values, with F16C when the compiler targets it
+void floatsToHalves( const float* in, unsigned short* out, int count );
+void halvesToFloats( const unsigned short* in, float* out, int count );
+
+struct half {
+	unsigned short  bits;
+
+	half() : bits(0) {}
+
+	half( float f ) : bits(floatToHalf( f )) {}
+
+	operator float () const { return halfToFloat( bits ); }
+};
+
+//type the arithmetic of T happens in
+template <class T> struct TvecCompute { typedef T type; };
+template <> struct TvecCompute<half> { typedef float type; };
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tvec<T, N> - the members and constructors differ per size, the
+//  arithmetic below is written once for every size
+//
+
+template <class T, int N> struct tvec;
+
+template <class T>
+struct tvec<T, 2> {
+	T  x;
+	T  y;
+
+	//
+	//  --- Constructors and Destructors ---
+	//
+
+	tvec( T s = T(0) ) :
+	x(s), y(s) {}
+
+	tvec( T x, T y ) :
+	x(x), y(y) {}
+
+	template <class U>
+	explicit tvec( const tvec<U, 2>& v ) :
+	x(T(v.x)), y(T(v.y)) {}
+
+	explicit tvec( const vec2& v ) :
+	x(T(v.x)), y(T(v.y)) {}
+
+	//
+	//  --- Indexing Operator ---
+	//
+
+	T& operator [] ( int i ) { return *(&x + i); }
+	const T operator [] ( int i ) const { return *(&x + i); }
+};
+
+template <class T>
+struct tvec<T, 3> {
+	T  x;
+	T  y;
+	T  z;
+
+	//
+	//  --- Constructors and Destructors ---
+	//
+
+	tvec( T s = T(0) ) :
+	x(s), y(s), z(s) {}
+
+	tvec( T x, T y, T z ) :
+	x(x), y(y), z(z) {}
+
+	template <class U>
+	explicit tvec( const tvec<U, 3>& v ) :
+	x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
+
+	explicit tvec( const vec3& v ) :
+	x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
+
+	//
+	//  --- Indexing Operator ---
+	//
+
+	T& operator [] ( int i ) { return *(&x + i); }
+	const T operator [] ( int i ) const { return *(&x + i); }
+};
+
+template <class T>
+struct tvec<T, 4> {
+	T  x;
+	T  y;
+	T  z;
+	T  w;
+
+	//
+	//  --- Constructors and Destructors ---
+	//
+
+	tvec( T s = T(0) ) :
+	x(s), y(s), z(s), w(s) {}
+
+	tvec( T x, T y, T z, T w ) :
+	x(x), y(y), z(z), w(w) {}
+
+	tvec( const tvec<T, 3>& v, T w ) :
+	x(v.x), y(v.y), z(v.z), w(w) {}
+
+	template <class U>
+	explicit tvec( const tvec<U, 4>& v ) :
+	x(T(v.x)), y(T(v.y)), z(T(v.z)), w(T(v.w)) {}
+
+	explicit tvec( const vec4& v ) :
+	x(T(v.x)), y(T(v.y)), z(T(v.z)), w(T(v.w)) {}
+
+	//
+	//  --- Indexing Operator ---
+	//
+
+	T& operator [] ( int i ) { return *(&x + i); }
+	const T operator [] ( int i ) const { return *(&x + i); }
+};
+
+typedef tvec<double, 2>  dvec2;
+typedef tvec<double, 3>  dvec3;
+typedef tvec<double, 4>  dvec4;
+
+typedef tvec<half, 2>  hvec2;
+typedef tvec<half, 3>  hvec3;
+typedef tvec<half, 4>  hvec4;
+
+//----------------------------------------------------------------------------
+//
+//  Non-class tvec Methods
+//
+//  the scalar arguments are in the compute type, so 2.0 * v works for any T
+//
+
+template <class T, int N>
+inline tvec<T, N> operator - ( const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	tvec<T, N> r;
+	for ( int i = 0; i < N; ++i )
+		r[i] = T( -C( v[i] ) );
+	return r;
+}
+
+template <class T, int N>
+inline tvec<T, N> operator + ( const tvec<T, N>& u, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	tvec<T, N> r;
+	for ( int i = 0; i < N; ++i )
+		r[i] = T( C( u[i] ) + C( v[i] ) );
+	return r;
+}
+
+template <class T, int N>
+inline tvec<T, N> operator - ( const tvec<T, N>& u, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	tvec<T, N> r;
+	for ( int i = 0; i < N; ++i )
+		r[i] = T( C( u[i] ) - C( v[i] ) );
+	return r;
+}
+
+template <class T, int N>
+inline tvec<T, N> operator * ( const tvec<T, N>& u, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	tvec<T, N> r;
+	for ( int i = 0; i < N; ++i )
+		r[i] = T( C( u[i] ) * C( v[i] ) );
+	return r;
+}
+
+template <class T, int N>
+inline tvec<T, N> operator * ( const tvec<T, N>& v, const typename TvecCompute<T>::type s ) {
+	typedef typename TvecCompute<T>::type C;
+	tvec<T, N> r;
+	for ( int i = 0; i < N; ++i )
+		r[i] = T( s * C( v[i] ) );
+	return r;
+}
+
+template <class T, int N>
+inline tvec<T, N> operator * ( const typename TvecCompute<T>::type s, const tvec<T, N>& v )
+{ return v * s; }
+
+template <class T, int N>
+inline tvec<T, N> operator / ( const tvec<T, N>& v, const typename TvecCompute<T>::type s ) {
+	typedef typename TvecCompute<T>::type C;
+	return v * ( C(1) / s );
+}
+
+template <class T, int N>
+inline tvec<T, N>& operator += ( tvec<T, N>& u, const tvec<T, N>& v )
+{ return u = u + v; }
+
+template <class T, int N>
+inline tvec<T, N>& operator -= ( tvec<T, N>& u, const tvec<T, N>& v )
+{ return u = u - v; }
+
+template <class T, int N>
+inline tvec<T, N>& operator *= ( tvec<T, N>& v, const typename TvecCompute<T>::type s )
+{ return v = v * s; }
+
+template <class T, int N>
+inline tvec<T, N>& operator /= ( tvec<T, N>& v, const typename TvecCompute<T>::type s )
+{ return v = v / s; }
+
+template <class T, int N>
+inline bool operator == ( const tvec<T, N>& u, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	for ( int i = 0; i < N; ++i )
+		if ( C( u[i] ) != C( v[i] ) )
+			return false;
+	return true;
+}
+
+template <class T, int N>
+inline typename TvecCompute<T>::type dot( const tvec<T, N>& u, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	C sum = C( u[0] ) * C( v[0] );
+	for ( int i = 1; i < N; ++i )
+		sum += C( u[i] ) * C( v[i] );
+	return sum;
+}
+
+template <class T, int N>
+inline typename TvecCompute<T>::type length( const tvec<T, N>& v ) {
+	return std::sqrt( dot( v, v ) );
+}
+
+template <class T, int N>
+inline tvec<T, N> normalize( const tvec<T, N>& v ) {
+	return v / length( v );
+}
+
+template <class T>
+inline tvec<T, 3> cross( const tvec<T, 3>& a, const tvec<T, 3>& b ) {
+	typedef typename TvecCompute<T>::type C;
+	return tvec<T, 3>( T( C( a.y ) * C( b.z ) - C( a.z ) * C( b.y ) ),
+			   T( C( a.z ) * C( b.x ) - C( a.x ) * C( b.z ) ),
+			   T( C( a.x ) * C( b.y ) - C( a.y ) * C( b.x ) ) );
+}
+
+template <class T, int N>
+inline std::ostream& operator << ( std::ostream& os, const tvec<T, N>& v ) {
+	typedef typename TvecCompute<T>::type C;
+	os << "( " << C( v[0] );
+	for ( int i = 1; i < N; ++i )
+		os << ", " << C( v[i] );
+	return os << " )";
+}
+
+//back to the GLfloat types
+template <class T>
+inline vec2 toVec( const tvec<T, 2>& v )
+{ return vec2( GLfloat( v.x ), GLfloat( v.y ) ); }
+
+template <class T>
+inline vec3 toVec( const tvec<T, 3>& v )
+{ return vec3( GLfloat( v.x ), GLfloat( v.y ), GLfloat( v.z ) ); }
+
+template <class T>
+inline vec4 toVec( const tvec<T, 4>& v )
+{ return vec4( GLfloat( v.x ), GLfloat( v.y ), GLfloat( v.z ), GLfloat( v.w ) ); }
+
+//pack count vec2/3/4 into hvec2/3/4 with floatsToHalves
+template <class V, int N>
+inline void toHalves( const V* in, tvec<half, N>* out, int count ) {
+	static_assert( sizeof( V ) == N * sizeof( GLfloat ) && sizeof( tvec<half, N> ) == N * sizeof( half ),
+		       "toHalves needs tightly packed vectors" );
+	floatsToHalves( static_cast<const GLfloat*>( *in ), &out->x.bits, N * count );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  tmat<T, R, C> - R x C matrix, _m[i][j] is row i column j as in mat.h
+//
+
+template <class T, int R, int C>
+class tmat {
+	tvec<T, C>  _m[R];
+
+   public:
+	//
+	//  --- Constructors and Destructors ---
+	//
+
+	explicit tmat( const T d = T(1) )  // Create a diagonal matrix
+	{
+		for ( int i = 0; i < R && i < C; ++i )
+			_m[i][i] = d;
+	}
+
+	template <class U>
+	explicit tmat( const tmat<U, R, C>& m )
+	{
+		for ( int i = 0; i < R; ++i )
+			_m[i] = tvec<T, C>( m[i] );
+	}
+
+	//from the GLfloat matrix of the same size
+	explicit tmat( const mat2& m ) { static_assert( R == 2 && C == 2, "tmat size" ); from( m ); }
+	explicit tmat( const mat3& m ) { static_assert( R == 3 && C == 3, "tmat size" ); from( m ); }
+	explicit tmat( const mat4& m ) { static_assert( R == 4 && C == 4, "tmat size" ); from( m ); }
+
+	//
+	//  --- Indexing Operator ---
+	//
+
+	tvec<T, C>& operator [] ( int i ) { return _m[i]; }
+	const tvec<T, C>& operator [] ( int i ) const { return _m[i]; }
+
+   private:
+	template <class M>
+	void from( const M& m )
+	{
+		for ( int i = 0; i < R; ++i )
+			for ( int j = 0; j < C; ++j )
+				_m[i][j] = T( m[i][j] );
+	}
+};
+
+typedef tmat<double, 2, 2>  dmat2;
+typedef tmat<double, 3, 3>  dmat3;
+typedef tmat<double, 4, 4>  dmat4;
+
+//----------------------------------------------------------------------------
+//
+//  Non-class tmat Methods
+//
+
+template <class T, int R, int C>
+inline tmat<T, R, C> operator + ( const tmat<T, R, C>& a, const tmat<T, R, C>& b ) {
+	tmat<T, R, C> r;
+	for ( int i = 0; i < R; ++i )
+		r[i] = a[i] + b[i];
+	return r;
+}
+
+template <class T, int R, int C>
+inline tmat<T, R, C> operator - ( const tmat<T, R, C>& a, const tmat<T, R, C>& b ) {
+	tmat<T, R, C> r;
+	for ( int i = 0; i < R; ++i )
+		r[i] = a[i] - b[i];
+	return r;
+}
+
+template <class T, int R, int C>
+inline tmat<T, R, C> operator * ( const tmat<T, R, C>& m, const typename TvecCompute<T>::type s ) {
+	tmat<T, R, C> r;
+	for ( int i = 0; i < R; ++i )
+		r[i] = m[i] * s;
+	return r;
+}
+
+template <class T, int R, int C>
+inline tmat<T, R, C> operator * ( const typename TvecCompute<T>::type s, const tmat<T, R, C>& m )
+{ return m * s; }
+
+template <class T, int R, int K, int C>
+inline tmat<T, R, C> operator * ( const tmat<T, R, K>& a, const tmat<T, K, C>& b ) {
+	typedef typename TvecCompute<T>::type S;
+	tmat<T, R, C> r;
+	for ( int i = 0; i < R; ++i ) {
+		for ( int j = 0; j < C; ++j ) {
+		S sum = S( a[i][0] ) * S( b[0][j] );
+		for ( int k = 1; k < K; ++k )
+			sum += S( a[i][k] ) * S( b[k][j] );
+		r[i][j] = T( sum );
+		}
+	}
+	return r;
+}
+
+template <class T, int R, int C>
+inline tvec<T, R> operator * ( const tmat<T, R, C>& m, const tvec<T, C>& v ) {  // m * v
+	tvec<T, R> r;
+	for ( int i = 0; i < R; ++i )
+		r[i] = T( dot( m[i], v ) );
+	return r;
+}
+
+template <class T, int R, int C>
+inline tmat<T, C, R> transpose( const tmat<T, R, C>& m ) {
+	tmat<T, C, R> r;
+	for ( int i = 0; i < R; ++i )
+		for ( int j = 0; j < C; ++j )
+			r[j][i] = m[i][j];
+	return r;
+}
+
+template <class T, int R, int C>
+inline std::ostream& operator << ( std::ostream& os, const tmat<T, R, C>& m ) {
+	for ( int i = 0; i < R; ++i )
+		os << std::endl << m[i];
+	return os << std::endl;
+}
+
+//back to the GLfloat types
+template <class T>
+inline mat2 toMat( const tmat<T, 2, 2>& m )
+{ return mat2( toVec( m[0] ), toVec( m[1] ) ); }
+
+template <class T>
+inline mat3 toMat( const tmat<T, 3, 3>& m )
+{ return mat3( toVec( m[0] ), toVec( m[1] ), toVec( m[2] ) ); }
+
+template <class T>
+inline mat4 toMat( const tmat<T, 4, 4>& m )
+{ return mat4( toVec( m[0] ), toVec( m[1] ), toVec( m[2] ), toVec( m[3] ) ); }
+
+#endif // __TVEC_H__
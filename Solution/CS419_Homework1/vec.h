@@ -8,14 +8,28 @@
 #define __VEC_H__
 
 #include <iostream>
+#include <cmath>
 #include "openglutl.h"
 
+#ifdef CS419_VEC_EXPR
+#include "vecexpr.h"
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 //
 //  vec2.h - 2D vector
 //
 
-struct vec2 {
+#ifdef CS419_VEC_EXPR
+struct vec2;
+template <> struct ExprTraits<vec2> { enum { size = 2, vector = 1 }; typedef GLfloat row; };
+#endif
+
+struct vec2
+#ifdef CS419_VEC_EXPR
+	: Expr<vec2, vec2>
+#endif
+{
 	GLfloat  x;
 	GLfloat  y;
 
@@ -29,9 +43,6 @@ struct vec2 {
 	vec2( GLfloat x, GLfloat y ) :
 	x(x), y(y) {}
 
-	vec2( const vec2& v )
-	{ x = v.x;  y = v.y;  }
-
 	//
 	//  --- Indexing Operator ---
 	//
@@ -39,6 +50,7 @@ struct vec2 {
 	GLfloat& operator [] ( int i ) { return *(&x + i); }
 	const GLfloat operator [] ( int i ) const { return *(&x + i); }
 
+#ifndef CS419_VEC_EXPR
 	//
 	//  --- (non-modifying) Arithematic Operators ---
 	//
@@ -73,6 +85,7 @@ struct vec2 {
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
 	}
+#endif // CS419_VEC_EXPR
 
 	//
 	//  --- (modifying) Arithematic Operators ---
@@ -152,7 +165,16 @@ vec2 normalize( const vec2& v ) {
 //
 //////////////////////////////////////////////////////////////////////////////
 
-struct vec3 {
+#ifdef CS419_VEC_EXPR
+struct vec3;
+template <> struct ExprTraits<vec3> { enum { size = 3, vector = 1 }; typedef GLfloat row; };
+#endif
+
+struct vec3
+#ifdef CS419_VEC_EXPR
+	: Expr<vec3, vec3>
+#endif
+{
 	GLfloat  x;
 	GLfloat  y;
 	GLfloat  z;
@@ -167,8 +189,6 @@ struct vec3 {
 	vec3( GLfloat x, GLfloat y, GLfloat z ) :
 	x(x), y(y), z(z) {}
 
-	vec3( const vec3& v ) { x = v.x;  y = v.y;  z = v.z; }
-
 	vec3( const vec2& v, const float f ) { x = v.x;  y = v.y;  z = f; }
 
 	//
@@ -178,6 +198,7 @@ struct vec3 {
 	GLfloat& operator [] ( int i ) { return *(&x + i); }
 	const GLfloat operator [] ( int i ) const { return *(&x + i); }
 
+#ifndef CS419_VEC_EXPR
 	//
 	//  --- (non-modifying) Arithematic Operators ---
 	//
@@ -212,6 +233,7 @@ struct vec3 {
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
 	}
+#endif // CS419_VEC_EXPR
 
 	//
 	//  --- (modifying) Arithematic Operators ---
@@ -299,7 +321,16 @@ vec3 cross(const vec3& a, const vec3& b )
 //
 //////////////////////////////////////////////////////////////////////////////
 
-struct vec4 {
+#ifdef CS419_VEC_EXPR
+struct vec4;
+template <> struct ExprTraits<vec4> { enum { size = 4, vector = 1 }; typedef GLfloat row; };
+#endif
+
+struct vec4
+#ifdef CS419_VEC_EXPR
+	: Expr<vec4, vec4>
+#endif
+{
 	GLfloat  x;
 	GLfloat  y;
 	GLfloat  z;
@@ -315,8 +346,6 @@ struct vec4 {
 	vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
 	x(x), y(y), z(z), w(w) {}
 
-	vec4( const vec4& v ) { x = v.x;  y = v.y;  z = v.z;  w = v.w; }
-
 	vec4( const vec3& v, const float w = 1.0 ) : w(w)
 	{ x = v.x;  y = v.y;  z = v.z; }
 
@@ -330,6 +359,7 @@ struct vec4 {
 	GLfloat& operator [] ( int i ) { return *(&x + i); }
 	const GLfloat operator [] ( int i ) const { return *(&x + i); }
 
+#ifndef CS419_VEC_EXPR
 	//
 	//  --- (non-modifying) Arithematic Operators ---
 	//
@@ -347,7 +377,7 @@ struct vec4 {
 	{ return vec4( s*x, s*y, s*z, s*w ); }
 
 	vec4 operator * ( const vec4& v ) const
-	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.z ); }
+	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.w ); }
 
 	friend vec4 operator * ( const GLfloat s, const vec4& v )
 	{ return v * s; }
@@ -364,6 +394,7 @@ struct vec4 {
 	GLfloat r = GLfloat(1.0) / s;
 	return *this * r;
 	}
+#endif // CS419_VEC_EXPR
 
 	//
 	//  --- (modifying) Arithematic Operators ---
@@ -433,7 +464,7 @@ struct vec4 {
 
 inline
 GLfloat dot( const vec4& u, const vec4& v ) {
-	return u.x*v.x + u.y*v.y + u.z*v.z + u.w+v.w;
+	return u.x*v.x + u.y*v.y + u.z*v.z + u.w*v.w;
 }
 
 inline
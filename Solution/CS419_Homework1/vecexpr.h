@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- vecexpr.h ---
+//
+//  Expression templates for the element-wise arithmetic of vec.h and mat.h,
+//  compiled in with CS419_VEC_EXPR (cmake -DCS419_VEC_EXPR=ON).
+//
+//  a * b + c * d builds a tree of references instead of three temporaries,
+//  the tree is evaluated element by element in one pass when it is assigned
+//  to (or passed as) a vec or mat, so call sites do not change.
+//  Matrix products and matrix * vector stay eager, their elements are not
+//  independent and the result could alias an operand.
+//
+//  Never hold an expression in a variable of its own (no auto), it refers
+//  to temporaries that die at the end of the full expression.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VEC_EXPR__
+#define __VEC_EXPR__
+
+//size is the number of floats of T, vector is 1 for vec2/3/4 (they multiply element-wise),
+//row is what T's operator [] returns
+template <class T> struct ExprTraits;
+
+//base of every expression and of the vec and mat types themselves, E is the derived type
+//and T the type it evaluates to
+template <class E, class T>
+struct Expr {
+	operator T () const {
+	T r;
+	GLfloat* p = r;
+	const E& e = static_cast<const E&>( *this );
+	for ( int i = 0; i < ExprTraits<T>::size; ++i )
+		p[i] = e.at( i );
+	return r;
+	}
+};
+
+//base of the operator results, indexing one evaluates it first
+template <class E, class T>
+struct ExprNode : Expr<E, T> {
+	typename ExprTraits<T>::row operator [] ( int i ) const
+	{ return T( *this )[i]; }
+};
+
+//element i of a vec or mat, which are their own leaf expressions
+template <class E, class T>
+inline GLfloat exprAt( const Expr<E, T>& e, int i )
+{ return static_cast<const E&>( e ).at( i ); }
+
+template <class T>
+inline GLfloat exprAt( const Expr<T, T>& e, int i )
+{ return static_cast<const GLfloat*>( static_cast<const T&>( e ) )[i]; }
+
+struct ExprAdd { static GLfloat apply( GLfloat a, GLfloat b ) { return a + b; } };
+struct ExprSub { static GLfloat apply( GLfloat a, GLfloat b ) { return a - b; } };
+struct ExprMul { static GLfloat apply( GLfloat a, GLfloat b ) { return a * b; } };
+
+template <class L, class R, class T, class Op>
+struct BinaryExpr : ExprNode<BinaryExpr<L, R, T, Op>, T> {
+	const L&  l;
+	const R&  r;
+
+	BinaryExpr( const L& l, const R& r ) : l(l), r(r) {}
+
+	GLfloat at( int i ) const { return Op::apply( exprAt( l, i ), exprAt( r, i ) ); }
+};
+
+template <class E, class T>
+struct ScaleExpr : ExprNode<ScaleExpr<E, T>, T> {
+	const E&  e;
+	GLfloat   s;
+
+	ScaleExpr( const E& e, GLfloat s ) : e(e), s(s) {}
+
+	GLfloat at( int i ) const { return s * exprAt( e, i ); }
+};
+
+template <class E, class T>
+struct NegateExpr : ExprNode<NegateExpr<E, T>, T> {
+	const E&  e;
+
+	NegateExpr( const E& e ) : e(e) {}
+
+	GLfloat at( int i ) const { return -exprAt( e, i ); }
+};
+
+//the return type of the element-wise product, which only vectors have
+template <bool vector, class R> struct ExprIfVector {};
+template <class R> struct ExprIfVector<true, R> { typedef R type; };
+
+//
+//  --- Operators ---
+//
+
+template <class L, class R, class T>
+inline BinaryExpr<L, R, T, ExprAdd> operator + ( const Expr<L, T>& l, const Expr<R, T>& r )
+{ return BinaryExpr<L, R, T, ExprAdd>( static_cast<const L&>( l ), static_cast<const R&>( r ) ); }
+
+template <class L, class R, class T>
+inline BinaryExpr<L, R, T, ExprSub> operator - ( const Expr<L, T>& l, const Expr<R, T>& r )
+{ return BinaryExpr<L, R, T, ExprSub>( static_cast<const L&>( l ), static_cast<const R&>( r ) ); }
+
+template <class L, class R, class T>
+inline typename ExprIfVector<ExprTraits<T>::vector != 0, BinaryExpr<L, R, T, ExprMul> >::type
+operator * ( const Expr<L, T>& l, const Expr<R, T>& r )
+{ return BinaryExpr<L, R, T, ExprMul>( static_cast<const L&>( l ), static_cast<const R&>( r ) ); }
+
+template <class E, class T>
+inline ScaleExpr<E, T> operator * ( const Expr<E, T>& e, const GLfloat s )
+{ return ScaleExpr<E, T>( static_cast<const E&>( e ), s ); }
+
+template <class E, class T>
+inline ScaleExpr<E, T> operator * ( const GLfloat s, const Expr<E, T>& e )
+{ return ScaleExpr<E, T>( static_cast<const E&>( e ), s ); }
+
+//one reciprocal and a multiply per element, like the eager operators
+template <class E, class T>
+inline ScaleExpr<E, T> operator / ( const Expr<E, T>& e, const GLfloat s )
+{ return ScaleExpr<E, T>( static_cast<const E&>( e ), GLfloat(1.0) / s ); }
+
+template <class E, class T>
+inline NegateExpr<E, T> operator - ( const Expr<E, T>& e )
+{ return NegateExpr<E, T>( static_cast<const E&>( e ) ); }
+
+#endif // __VEC_EXPR__
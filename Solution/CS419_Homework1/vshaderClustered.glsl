@@ -0,0 +1,51 @@
+#version 430
+
+//clustered forward shading, same transforms as vshaderTexture.glsl and
+//vshaderFinalTexture.glsl but the lights are looked up per fragment
+
+in  vec4 vPosition;
+in  vec3 vNormal;
+in  vec3 vTangent;
+in  vec2 vTexCoord;
+in  vec4 vOffset;
+
+out vec3 P;
+out vec3 N;
+out vec3 T;
+out vec2 texCoord;
+
+uniform mat4 ModelView, Projection;
+uniform vec4 Rot;
+
+invariant gl_Position;
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+
+void main() 
+{
+	vec4 rPosition = q_rot(Rot, vPosition);
+	rPosition.xyz = rPosition.xyz * vOffset.w + vOffset.xyz;
+	vec3 rNormal = q_rot(Rot, vec4(vNormal, 0.0)).xyz;
+	vec3 rTangent = q_rot(Rot, vec4(vTangent, 0.0)).xyz;
+
+	//everything in eye space, the bump map is applied there instead of in tangent space
+	P = (ModelView * rPosition).xyz;
+	N = (ModelView * vec4(rNormal, 0.0)).xyz;
+	T = (ModelView * vec4(rTangent, 0.0)).xyz;
+
+	texCoord = vTexCoord;
+
+	gl_Position = Projection * ModelView * rPosition;
+}
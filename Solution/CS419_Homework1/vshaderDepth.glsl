@@ -0,0 +1,34 @@
+#version 130
+
+//position only, for the depth pre-pass
+//must compute gl_Position exactly like the shading shaders for GL_EQUAL to match
+
+in  vec4 vPosition;
+in  vec4 vOffset;
+
+uniform mat4 ModelView, Projection;
+uniform vec4 Rot;
+
+invariant gl_Position;
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+
+void main() 
+{
+	vec4 rPosition = q_rot(Rot, vPosition);
+	rPosition.xyz = rPosition.xyz * vOffset.w + vOffset.xyz;
+
+	gl_Position = Projection * ModelView * rPosition;
+}
@@ -4,24 +4,48 @@ in  vec4 vPosition;
 in  vec3 vNormal;
 in  vec3 vTangent;
 in  vec2 vTexCoord;
+in  vec4 vOffset;
 
 out vec3 L;
 out vec3 V;
 out vec2 texCoord;
+out vec3 S;
 
-uniform mat4 ModelView, Projection, Trans;
-uniform vec4 LightPosition, Eye;
+uniform mat4 ModelView, Projection;
+uniform vec4 LightPosition, Rot;
+
+//bit identical to vshaderDepth.glsl for the depth pre-pass
+invariant gl_Position;
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
 
 
 void main() 
 {   
+	//rotate the model with the trackball quaternion
+	vec4 rPosition = q_rot(Rot, vPosition);
+	rPosition.xyz = rPosition.xyz * vOffset.w + vOffset.xyz;
+	vec3 rNormal = q_rot(Rot, vec4(vNormal, 0.0)).xyz;
+	vec3 rTangent = q_rot(Rot, vec4(vTangent, 0.0)).xyz;
+
 	//create our tangent space vectors
-	vec3 N = normalize(ModelView * Trans * vec4(vNormal, 0.0)).xyz;
-	vec3 T = normalize(ModelView * Trans * vec4(vTangent, 0.0)).xyz;
+	vec3 N = normalize(ModelView * vec4(rNormal, 0.0)).xyz;
+	vec3 T = normalize(ModelView * vec4(rTangent, 0.0)).xyz;
 	vec3 B = cross(N, T);
 
 	// find our normal positions for the eye and light
-	vec3 eyePosition = (ModelView * Trans * vPosition).xyz;
+	vec3 eyePosition = (ModelView * rPosition).xyz;
 	vec3 eyeLightPosition = (ModelView * LightPosition).xyz;
 
 	//Create light vector in tangent space coordinates
@@ -34,8 +58,11 @@ void main()
 	V.y = dot(B, -eyePosition);	
 	V.z = dot(N, -eyePosition);
 
+	//world space light to fragment vector for the shadow lookup
+	S = rPosition.xyz - LightPosition.xyz;
+
 	//pass texture coordinates to fragment shader
 	texCoord = vTexCoord;
 
-	gl_Position = Projection * ModelView * Trans *  vPosition;
+	gl_Position = Projection * ModelView * rPosition;
 }
@@ -0,0 +1,34 @@
+#version 130
+
+//sphere impostors, each instance is one quad that fshaderImpostor.glsl ray casts
+//the quad faces the eye and is just big enough to hold the sphere's silhouette
+
+in  vec4 vOffset;
+
+out vec3 P;
+flat out vec3 C;
+flat out float R;
+
+uniform mat4 ModelView, Projection;
+
+void main() 
+{
+	//corners of the strip from the vertex index, no vertex buffer needed
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+
+	//the mesh is the unit sphere, so the instance scale is the radius
+	C = (ModelView * vec4(vOffset.xyz, 1.0)).xyz;
+	R = vOffset.w;
+
+	//the silhouette cone cuts the plane through the center in a circle of this radius
+	float d2 = dot(C, C);
+	float size = R * sqrt(d2 / max(d2 - R * R, 1.0e-6));
+
+	vec3 w = normalize(C);
+	vec3 u = abs(w.y) < 0.99 ? normalize(cross(w, vec3(0.0, 1.0, 0.0))) : vec3(1.0, 0.0, 0.0);
+	vec3 v = cross(u, w);
+
+	P = C + (corner.x * u + corner.y * v) * size;
+
+	gl_Position = Projection * vec4(P, 1.0);
+}
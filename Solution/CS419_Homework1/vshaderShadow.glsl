@@ -0,0 +1,30 @@
+#version 150
+
+//shadow casters, world space positions for gshaderShadow.glsl
+
+in  vec4 vPosition;
+in  vec4 vOffset;
+
+out vec3 worldPosition;
+
+uniform vec4 Rot;
+
+
+vec4 q_multiply(vec4 a, vec4 b){
+	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
+}
+
+vec4 q_inverse(vec4 q){
+	return 1/length(q) * vec4( q.x, -q.yzw);
+}
+
+vec4 q_rot(vec4 q, vec4 v){
+	return vec4(q_multiply(q_multiply(q, vec4(0, v.xyz)), q_inverse(q)).yzw, v.w);
+}
+
+
+void main() 
+{
+	vec4 rPosition = q_rot(Rot, vPosition);
+	worldPosition = rPosition.xyz * vOffset.w + vOffset.xyz;
+}
@@ -0,0 +1,15 @@
+#version 430
+
+//tessellated spheres, the corners of the base octahedron go straight to tcshaderTess.glsl
+
+in  vec4 vPosition;
+in  vec4 vOffset;
+
+out vec3 cPosition;
+out vec4 cOffset;
+
+void main() 
+{
+	cPosition = vPosition.xyz;
+	cOffset = vOffset;
+}
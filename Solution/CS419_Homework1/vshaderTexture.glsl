@@ -3,15 +3,20 @@
 in  vec4 vPosition;
 in  vec3 vNormal;
 in  vec2 vTexCoord;
+in  vec4 vOffset;
 
 out vec3 N;
 out vec3 E;
 out vec3 L;
 out vec2 texCoord;
+out vec3 S;
 
 uniform mat4 ModelView, Projection;
 uniform vec4 LightPosition, Rot;
 
+//bit identical to vshaderDepth.glsl for the depth pre-pass
+invariant gl_Position;
+
 
 vec4 q_multiply(vec4 a, vec4 b){
 	return vec4(a.x * b.x - dot(a.yzw, b.yzw), a.x * b.yzw + b.x * a.yzw + cross(a.yzw, b.yzw));
@@ -30,7 +35,9 @@ vec4 q_rot(vec4 q, vec4 v){
 void main() 
 {   
 
+	//rotate about the sphere's own center, then place the instance
 	vec4 rPosition = q_rot(Rot, vPosition);
+	rPosition.xyz = rPosition.xyz * vOffset.w + vOffset.xyz;
 	vec3 rNormal =  q_rot(Rot, vec4(vNormal, 0.0)).xyz;
 
 	N = (ModelView * vec4(rNormal, 0.0)).xyz; 
@@ -42,6 +49,9 @@ void main()
 		L = L + E.xyz;
 	}
 
+	//world space light to fragment vector for the shadow lookup
+	S = rPosition.xyz - LightPosition.xyz;
+
 	//pass texture coordinates to fragment shader
 	texCoord = vTexCoord;
 